@@ -0,0 +1,297 @@
+//============================
+// image_test.cpp
+//
+// Host test for image.h. BMP and PCX files of each kind
+// the decoder takes are written in memory from a random
+// palette and image, decoded, and every pixel checked
+// against vga_rgbi() of its palette entry. Files named on
+// the command line are also decoded, e.g. ones saved from
+// a paint program, and their size and rows reported.
+// See run_host_tests.sh.
+//============================
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "image.h"
+
+typedef std::vector<uint8_t> bytes;
+
+static int bad = 0;
+
+static void fail(const char *name, const char *what) {
+  printf("%s: %s\n", name, what);
+  bad++;
+}
+
+//=======================================================
+// Memory and stdio readers.
+//=======================================================
+typedef struct {
+  const bytes *data;
+  uint32_t pos;
+} mem_file;
+
+static int memRead(void *ctx, uint8_t *buf, int n) {
+  mem_file *f = (mem_file *)ctx;
+  uint32_t left = f->data->size() - f->pos;
+  if((uint32_t)n > left) n = left;
+  memcpy(buf, f->data->data() + f->pos, n);
+  f->pos += n;
+  return n;
+}
+
+static int memSeek(void *ctx, uint32_t pos) {
+  mem_file *f = (mem_file *)ctx;
+  if(pos > f->data->size()) return -1;
+  f->pos = pos;
+  return 0;
+}
+
+static int fileRead(void *ctx, uint8_t *buf, int n) {
+  return fread(buf, 1, n, (FILE *)ctx);
+}
+
+static int fileSeek(void *ctx, uint32_t pos) {
+  return fseek((FILE *)ctx, pos, SEEK_SET);
+}
+
+//=======================================================
+// A test image, palette indexes, and its palette.
+//=======================================================
+typedef struct {
+  int w, h, colors;
+  std::vector<int> pixels;
+  std::vector<uint8_t> rgb;  // colors RGB triples.
+} test_image;
+
+static void makeImage(test_image *t, int w, int h, int colors) {
+  t->w = w;
+  t->h = h;
+  t->colors = colors;
+  t->rgb.resize(colors * 3);
+  for(int i = 0; i < colors * 3; i++) t->rgb[i] = rand() & 0xff;
+  t->pixels.resize(w * h);
+  // Mostly runs, so PCX has something to compress.
+  for(int y = 0; y < h; y++)
+    for(int x = 0; x < w; x++)
+      t->pixels[y * w + x] = ((rand() % 10) < 7) ? (x / 3 + y) % colors : rand() % colors;
+}
+
+static void put16(bytes &b, uint32_t v) {
+  b.push_back(v & 0xff);
+  b.push_back(v >> 8);
+}
+
+static void put32(bytes &b, uint32_t v) {
+  put16(b, v & 0xffff);
+  put16(b, v >> 16);
+}
+
+//=======================================================
+// Uncompressed BMP, 4 or 8 bit. extra bytes pad the info
+// header as later versions of it do.
+//=======================================================
+static bytes makeBmp(const test_image *t, int bits, bool topDown, int extra) {
+  int stride = ((t->w * bits + 31) / 32) * 4;
+  uint32_t palBytes = t->colors * 4;
+  uint32_t dataPos = 14 + 40 + extra + palBytes;
+  bytes b;
+  b.push_back('B');
+  b.push_back('M');
+  put32(b, dataPos + stride * t->h);
+  put32(b, 0);
+  put32(b, dataPos);
+  put32(b, 40 + extra);
+  put32(b, t->w);
+  put32(b, topDown ? -t->h : t->h);
+  put16(b, 1);
+  put16(b, bits);
+  put32(b, 0);  // Uncompressed.
+  put32(b, stride * t->h);
+  put32(b, 0);
+  put32(b, 0);
+  put32(b, t->colors);
+  put32(b, 0);
+  b.insert(b.end(), extra, 0);
+  for(int i = 0; i < t->colors; i++) {
+    b.push_back(t->rgb[i * 3 + 2]);
+    b.push_back(t->rgb[i * 3 + 1]);
+    b.push_back(t->rgb[i * 3]);
+    b.push_back(0);
+  }
+  for(int i = 0; i < t->h; i++) {
+    int y = topDown ? i : t->h - 1 - i;
+    const int *p = &t->pixels[y * t->w];
+    bytes row(stride, 0);
+    for(int x = 0; x < t->w; x++) {
+      if(bits == 8) row[x] = p[x];
+      else row[x >> 1] |= p[x] << ((x & 1) ? 0 : 4);
+    }
+    b.insert(b.end(), row.begin(), row.end());
+  }
+  return b;
+}
+
+//=======================================================
+// PCX run length encoding.
+//=======================================================
+static void pcxEncode(bytes &out, const bytes &in) {
+  for(size_t i = 0; i < in.size(); ) {
+    size_t j = i;
+    while((j < in.size()) && (in[j] == in[i]) && ((j - i) < 63)) j++;
+    if(((j - i) > 1) || (in[i] >= 0xc0)) {
+      out.push_back(0xc0 | (j - i));
+      out.push_back(in[i]);
+    } else {
+      out.push_back(in[i]);
+    }
+    i = j;
+  }
+}
+
+//=======================================================
+// PCX, 8 bit, 4 bit or 4 planes of 1 bit. cross lets
+// runs go on from one row to the next, as some writers do.
+//=======================================================
+static bytes makePcx(const test_image *t, int bits, int planes, bool cross) {
+  int bpl = (t->w * bits + 7) / 8;
+  bpl += bpl & 1;
+  bytes b;
+  b.push_back(0x0a);
+  b.push_back(5);
+  b.push_back(1);
+  b.push_back(bits);
+  put16(b, 0);
+  put16(b, 0);
+  put16(b, t->w - 1);
+  put16(b, t->h - 1);
+  put16(b, 72);
+  put16(b, 72);
+  for(int i = 0; i < 48; i++) b.push_back((t->colors == 16) ? t->rgb[i] : 0);
+  b.push_back(0);
+  b.push_back(planes);
+  put16(b, bpl);
+  put16(b, 1);
+  b.insert(b.end(), 58, 0);
+  bytes all;
+  for(int y = 0; y < t->h; y++) {
+    const int *p = &t->pixels[y * t->w];
+    bytes line(bpl * planes, 0);
+    for(int x = 0; x < t->w; x++) {
+      if(bits == 8) {
+        line[x] = p[x];
+      } else if(planes == 1) {
+        line[x >> 1] |= p[x] << ((x & 1) ? 0 : 4);
+      } else {
+        for(int k = 0; k < 4; k++)
+          if(p[x] & (1 << k)) line[k * bpl + (x >> 3)] |= 0x80 >> (x & 7);
+      }
+    }
+    if(cross) all.insert(all.end(), line.begin(), line.end());
+    else pcxEncode(b, line);
+  }
+  if(cross) pcxEncode(b, all);
+  if(bits == 8) {
+    b.push_back(0x0c);
+    b.insert(b.end(), t->rgb.begin(), t->rgb.end());
+  }
+  return b;
+}
+
+//=======================================================
+// Decode and check.
+//=======================================================
+typedef struct {
+  const test_image *t;
+  const char *name;
+  int rows;
+  bool wrong;
+} check_state;
+
+static void checkRow(void *ctx, int y, const uint8_t *pixels, int w) {
+  check_state *s = (check_state *)ctx;
+  const test_image *t = s->t;
+  s->rows++;
+  if((y < 0) || (y >= t->h) || (w != t->w)) {
+    s->wrong = true;
+    return;
+  }
+  for(int x = 0; x < w; x++) {
+    const uint8_t *c = &t->rgb[t->pixels[y * w + x] * 3];
+    if(pixels[x] != vga_rgbi(c[0], c[1], c[2])) s->wrong = true;
+  }
+}
+
+static void decode(const char *name, const test_image *t, const bytes &file) {
+  mem_file f = { &file, 0 };
+  vga_img_reader_t rd = { memRead, memSeek, &f, (uint32_t)file.size() };
+  static vga_img_t img;
+  if(vga_img_open(&img, &rd) < 0) return fail(name, "open failed");
+  if((img.w != t->w) || (img.h != t->h)) return fail(name, "wrong size");
+  check_state s = { t, name, 0, false };
+  if(vga_img_rows(&img, checkRow, &s) < 0) return fail(name, "rows failed");
+  if(s.rows != t->h) fail(name, "wrong row count");
+  if(s.wrong) fail(name, "wrong pixels");
+  // Cut short, must fail, not hang or overrun.
+  bytes cut(file.begin(), file.begin() + file.size() * 3 / 4);
+  mem_file g = { &cut, 0 };
+  rd.ctx = &g;
+  rd.size = cut.size();
+  if((vga_img_open(&img, &rd) == 0) && (vga_img_rows(&img, checkRow, &s) == 0))
+    fail(name, "short file not found");
+}
+
+//=======================================================
+// A file from the command line.
+//=======================================================
+static int fileRows;
+
+static void countRow(void *ctx, int y, const uint8_t *pixels, int w) {
+  fileRows++;
+}
+
+static void decodeFile(const char *name) {
+  FILE *f = fopen(name, "rb");
+  if(f == NULL) return fail(name, "can't open");
+  fseek(f, 0, SEEK_END);
+  vga_img_reader_t rd = { fileRead, fileSeek, f, (uint32_t)ftell(f) };
+  fseek(f, 0, SEEK_SET);
+  static vga_img_t img;
+  fileRows = 0;
+  if(vga_img_open(&img, &rd) < 0) fail(name, "not a supported image");
+  else if(vga_img_rows(&img, countRow, NULL) < 0) fail(name, "file short");
+  else if(fileRows != img.h) fail(name, "wrong row count");
+  else printf("%s: %dx%d %d bit %s\n", name, img.w, img.h, img.bits,
+              (img.format == VGA_IMG_BMP) ? "BMP" : "PCX");
+  fclose(f);
+}
+
+int main(int argc, char **argv) {
+  srand(1);
+  test_image t16, t256, small;
+  makeImage(&t16, 37, 23, 16);
+  makeImage(&t256, 37, 23, 256);
+  makeImage(&small, 20, 9, 16);
+  decode("bmp 8 bit", &t256, makeBmp(&t256, 8, false, 0));
+  decode("bmp 4 bit", &t16, makeBmp(&t16, 4, false, 0));
+  decode("bmp 4 bit top down, long header", &small, makeBmp(&small, 4, true, 84));
+  decode("bmp 8 bit top down", &t256, makeBmp(&t256, 8, true, 0));
+  decode("pcx 8 bit", &t256, makePcx(&t256, 8, 1, false));
+  decode("pcx 4 bit", &t16, makePcx(&t16, 4, 1, false));
+  decode("pcx 4 planes", &t16, makePcx(&t16, 1, 4, false));
+  decode("pcx 8 bit, runs across rows", &t256, makePcx(&t256, 8, 1, true));
+  decode("pcx 4 planes, runs across rows", &small, makePcx(&small, 1, 4, true));
+  // 8 bit PCX needs to seek to its palette.
+  bytes pcx8 = makePcx(&t256, 8, 1, false);
+  mem_file f = { &pcx8, 0 };
+  vga_img_reader_t rd = { memRead, NULL, &f, (uint32_t)pcx8.size() };
+  static vga_img_t img;
+  if(vga_img_open(&img, &rd) == 0) fail("pcx 8 bit", "opened without seek");
+  if((vga_rgbi(0, 0, 0) != 0) || (vga_rgbi(255, 255, 255) != 15) ||
+     (vga_rgbi(0xaa, 0, 0) != 4) || (vga_rgbi(0x55, 0x55, 0x55) != 8))
+    fail("vga_rgbi", "wrong color");
+  for(int i = 1; i < argc; i++) decodeFile(argv[i]);
+  printf("image: %d failures\n", bad);
+  return bad != 0;
+}
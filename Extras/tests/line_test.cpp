@@ -0,0 +1,120 @@
+//============================
+// line_test.cpp
+//
+// Host test for line.h. Random lines, many of them
+// running off the buffer, are drawn clipped to bands of
+// rows and to random rectangles, with both kernels at
+// both depths, and must give exactly the pixels of a
+// plain Bresenham line inside the clip rectangle.
+// See run_host_tests.sh.
+//============================
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "line.h"
+
+#define W 320
+#define H 240
+#define PITCH4 (W / 2 + 16)
+#define PITCH1 (W / 8 + 16)
+#define BAND 32
+
+static uint8_t ref4[H * PITCH4], got4[H * PITCH4];
+static uint8_t ref1[H * PITCH1], got1[H * PITCH1];
+
+static void pixel4(uint8_t *fb, int x, int y, uint8_t c) {
+  uint8_t *p = &fb[y * PITCH4 + (x >> 1)];
+  int sh = (x & 1) << 2;
+  *p = (*p & ~(0x0f << sh)) | (c << sh);
+}
+
+static void pixel1(uint8_t *fb, int x, int y) {
+  fb[y * PITCH1 + (x >> 3)] |= 1 << (x & 7);
+}
+
+//=======================================================
+// The whole line pixel by pixel, keeping those inside
+// the rectangle.
+//=======================================================
+static void reference(int x0, int y0, int x1, int y1, int cx0, int cy0, int cx1, int cy1) {
+  int dx = abs(x1 - x0), dy = abs(y1 - y0);
+  int sx = (x1 >= x0) ? 1 : -1, sy = (y1 >= y0) ? 1 : -1;
+  bool xMajor = dx >= dy;
+  int d = xMajor ? dx : dy, e = xMajor ? dy : dx;
+  int err = 2 * e - d;
+  int x = x0, y = y0;
+  for(int k = 0; k <= d; k++) {
+    if((x >= cx0) && (x <= cx1) && (y >= cy0) && (y <= cy1)) {
+      pixel4(ref4, x, y, 9);
+      pixel1(ref1, x, y);
+    }
+    if(err > 0) {
+      if(xMajor) y += sy;
+      else x += sx;
+      err -= 2 * d;
+    }
+    err += 2 * e;
+    if(xMajor) x += sx;
+    else y += sy;
+  }
+}
+
+static void draw(int x0, int y0, int x1, int y1, int cx0, int cy0, int cx1, int cy1, bool runs) {
+  int first, last;
+  if(!vga_line_clip(x0, y0, x1, y1, cx0, cy0, cx1, cy1, &first, &last)) return;
+  if(runs) {
+    vga_line_runs4(got4, PITCH4, x0, y0, x1, y1, 9, first, last);
+    vga_line_runs1(got1, PITCH1, x0, y0, x1, y1, 0xff, first, last);
+  } else {
+    vga_line4(got4, PITCH4, x0, y0, x1, y1, 9, first, last);
+    vga_line1(got1, PITCH1, x0, y0, x1, y1, 0xff, first, last);
+  }
+}
+
+static int coord(int n) {
+  return rand() % (3 * n) - n;
+}
+
+int main(void) {
+  int bad = 0;
+  int lines = 0;
+  srand(1);
+  for(int i = 0; i < 20000; i++) {
+    int x0 = coord(W), y0 = coord(H), x1 = coord(W), y1 = coord(H);
+    if(i & 1) y1 = y0 + (y1 - y0) / 8; // More shallow lines.
+    bool wide = abs(x1 - x0) >= abs(y1 - y0);
+    for(int pass = 0; pass < 2; pass++) {
+      bool runs = pass && wide;
+      if(pass && !wide) break;
+      // Bands of rows, then a random rectangle.
+      for(int r = 0; r < 2; r++) {
+        memset(ref4, 0, sizeof(ref4));
+        memset(got4, 0, sizeof(got4));
+        memset(ref1, 0, sizeof(ref1));
+        memset(got1, 0, sizeof(got1));
+        if(r == 0) {
+          reference(x0, y0, x1, y1, 0, 0, W - 1, H - 1);
+          for(int y = 0; y < H; y += BAND) {
+            int y2 = (y + BAND > H) ? H - 1 : y + BAND - 1;
+            draw(x0, y0, x1, y1, 0, y, W - 1, y2, runs);
+          }
+        } else {
+          int cx0 = rand() % W, cx1 = rand() % W, cy0 = rand() % H, cy1 = rand() % H;
+          if(cx0 > cx1) { int t = cx0; cx0 = cx1; cx1 = t; }
+          if(cy0 > cy1) { int t = cy0; cy0 = cy1; cy1 = t; }
+          reference(x0, y0, x1, y1, cx0, cy0, cx1, cy1);
+          draw(x0, y0, x1, y1, cx0, cy0, cx1, cy1, runs);
+        }
+        lines++;
+        if(memcmp(ref4, got4, sizeof(ref4)) || memcmp(ref1, got1, sizeof(ref1))) {
+          if(bad < 10)
+            printf("line (%d,%d)-(%d,%d) %s clip %d differs\n", x0, y0, x1, y1,
+                   runs ? "runs" : "pixels", r);
+          bad++;
+        }
+      }
+    }
+  }
+  printf("line: %d of %d clipped lines differ\n", bad, lines);
+  return bad != 0;
+}
@@ -0,0 +1,33 @@
+//============================
+// nibble_dsp.cpp
+//
+// The DSP kernels of nibble.h, built on its host stand in
+// for USUB8/SEL. nibble_test.cpp compares them with the
+// scalar kernels.
+//============================
+#define VGA_NIBBLE_EMULATE_DSP
+#include "nibble.h"
+
+#ifndef VGA_NIBBLE_DSP
+#error nibble.h did not select the DSP kernels
+#endif
+
+uint32_t dsp_sel_ge(uint32_t x, uint32_t y, uint32_t a, uint32_t b) {
+  return vga_sel_ge(x, y, a, b);
+}
+
+uint32_t dsp_nonzero(uint32_t w) {
+  return vga_nib_nonzero(w);
+}
+
+uint32_t dsp_key(uint32_t dst, uint32_t src, uint8_t key) {
+  return vga_nib_key(dst, src, key);
+}
+
+uint32_t dsp_subst(uint32_t w, uint8_t from, uint8_t to) {
+  return vga_nib_subst(w, from, to);
+}
+
+uint32_t dsp_swap(uint32_t w, uint8_t a, uint8_t b) {
+  return vga_nib_swap(w, a, b);
+}
@@ -0,0 +1,77 @@
+//============================
+// nibble_test.cpp
+//
+// Host test for nibble.h. The DSP kernels (nibble_dsp.cpp)
+// must give the same words as the scalar ones, and both
+// must match a nibble at a time reference.
+// See run_host_tests.sh.
+//============================
+#define VGA_NIBBLE_SCALAR
+#include <stdio.h>
+#include <stdlib.h>
+#include "nibble.h"
+
+uint32_t dsp_sel_ge(uint32_t x, uint32_t y, uint32_t a, uint32_t b);
+uint32_t dsp_nonzero(uint32_t w);
+uint32_t dsp_key(uint32_t dst, uint32_t src, uint8_t key);
+uint32_t dsp_subst(uint32_t w, uint8_t from, uint8_t to);
+uint32_t dsp_swap(uint32_t w, uint8_t a, uint8_t b);
+
+static int bad = 0;
+
+static void check(const char *what, uint32_t w, uint32_t got, uint32_t want) {
+  if(got == want) return;
+  if(bad < 10) printf("%s(%08x) = %08x, should be %08x\n", what, w, got, want);
+  bad++;
+}
+
+static uint32_t nibble(uint32_t w, int i) {
+  return (w >> (i * 4)) & 0x0f;
+}
+
+static uint32_t random32(void) {
+  return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+int main(void) {
+  srand(1);
+  // USUB8/SEL stand in against a byte at a time compare.
+  for(int i = 0; i < 1000000; i++) {
+    uint32_t x = random32(), y = random32(), a = random32(), b = random32();
+    if(i & 1) y = (y & 0xff00ff00UL) | (x & 0x00ff00ffUL); // Equal bytes.
+    uint32_t want = 0;
+    for(int j = 0; j < 32; j += 8) {
+      bool ge = ((x >> j) & 0xff) >= ((y >> j) & 0xff);
+      want |= ((ge ? a : b) >> j & 0xff) << j;
+    }
+    check("sel_ge", x, dsp_sel_ge(x, y, a, b), want);
+  }
+  // Every word with the top byte 0, then random ones with
+  // nibbles often 0.
+  for(uint32_t w = 0; w < 0x1000000UL; w++) {
+    uint32_t r = random32();
+    uint32_t v = r & (random32() | random32());
+    v &= ~(0xfUL << ((r >> 28) * 4)) | 0x0fffffffUL;
+    for(int k = 0; k < 2; k++) {
+      uint32_t u = k ? v : w;
+      uint32_t want = 0;
+      for(int i = 0; i < 8; i++)
+        if(nibble(u, i)) want |= 0xfUL << (i * 4);
+      check("nonzero scalar", u, vga_nib_nonzero(u), want);
+      check("nonzero dsp", u, dsp_nonzero(u), want);
+    }
+  }
+  // The color kernels built on it, every color pair.
+  for(int i = 0; i < 20000; i++) {
+    uint32_t w = random32(), dst = random32();
+    for(int a = 0; a < 16; a++) {
+      for(int b = 0; b < 16; b++) {
+        check("key", w, dsp_key(dst, w, a), vga_nib_key(dst, w, a));
+        check("subst", w, dsp_subst(w, a, b), vga_nib_subst(w, a, b));
+        check("swap", w, dsp_swap(w, a, b), vga_nib_swap(w, a, b));
+      }
+    }
+  }
+  printf("nibble: %d differences\n", bad);
+  return bad != 0;
+}
@@ -0,0 +1,20 @@
+#!/bin/sh
+# Builds and runs the host tests of the modules in src/
+# that have no Teensy dependencies. Needs a host C++
+# compiler, CXX if set, else c++. Image files given as
+# arguments are also decoded by image_test.
+set -e
+cd "$(dirname "$0")"
+SRC=../../src
+CXX=${CXX:-c++}
+OUT=${TMPDIR:-/tmp}/vga_4bit_t4_tests
+mkdir -p "$OUT"
+
+$CXX -O2 -Wall -I$SRC -o "$OUT/line_test" line_test.cpp $SRC/line.cpp $SRC/span.cpp
+"$OUT/line_test"
+
+$CXX -O2 -Wall -I$SRC -o "$OUT/nibble_test" nibble_test.cpp nibble_dsp.cpp
+"$OUT/nibble_test"
+
+$CXX -O2 -Wall -I$SRC -o "$OUT/image_test" image_test.cpp $SRC/image.cpp
+"$OUT/image_test" "$@"
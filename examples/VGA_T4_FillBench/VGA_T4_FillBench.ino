@@ -0,0 +1,98 @@
+// Fill benchmark.
+// Prints pixels per second for fillRect(), clear() and
+// horizontal lines on the serial monitor. The same areas
+// are also filled one drawPixel() at a time, which is how
+// spans were written before the word wide span fill, to
+// give a before/after figure.
+
+#include "VGA_4bit_T4.h"
+
+// Uncomment one of the following screen resolutions. Try them all:)
+//const vga_timing *timing = &t1024x768x60;
+//const vga_timing *timing = &t800x600x60;
+const vga_timing *timing = &t640x480x60;
+//const vga_timing *timing = &t640x400x70;
+
+// Must use this instance name. It's used in the driver.
+FlexIO2VGA vga4bit;
+
+int fb_width, fb_height;
+
+// Rectangle sizes to test.
+const int sizes[][2] = { {8, 8}, {33, 17}, {100, 100}, {320, 240}, {0, 0} };
+
+void report(const char *name, uint32_t pixels, uint32_t us) {
+  Serial.printf("%-24s %10lu pixels %8lu us %8.2f Mpixels/s\n", name,
+                pixels, us, (float)pixels / (float)us);
+}
+
+// Old style fill, one read-modify-write per pixel.
+void pixelRect(int x0, int y0, int x1, int y1, int color) {
+  for(int y = y0; y <= y1; y++)
+    for(int x = x0; x <= x1; x++) vga4bit.drawPixel(x, y, color);
+}
+
+void runBench() {
+  char name[32];
+  uint32_t t, pixels;
+  int loops = 20;
+
+  for(int s = 0; sizes[s][0]; s++) {
+    int w = sizes[s][0];
+    int h = sizes[s][1];
+    // Odd x so both ragged ends are hit.
+    int x = 1;
+    int y = 1;
+    pixels = (uint32_t)w * h * loops;
+
+    t = micros();
+    for(int i = 0; i < loops; i++) pixelRect(x, y, x + w - 1, y + h - 1, i & 15);
+    t = micros() - t;
+    sprintf(name, "drawPixel %dx%d", w, h);
+    report(name, pixels, t);
+
+    t = micros();
+    for(int i = 0; i < loops; i++) vga4bit.fillRect(x, y, x + w - 1, y + h - 1, i & 15);
+    t = micros() - t;
+    sprintf(name, "fillRect %dx%d", w, h);
+    report(name, pixels, t);
+  }
+
+  pixels = (uint32_t)fb_width * fb_height * loops;
+  t = micros();
+  for(int i = 0; i < loops; i++) vga4bit.clear(i & 15);
+  t = micros() - t;
+  report("clear", pixels, t);
+
+  pixels = 0;
+  t = micros();
+  for(int i = 0; i < loops; i++) {
+    for(int y = 0; y < fb_height; y++) {
+      vga4bit.drawHLine(y, y & 7, fb_width - 1 - (y & 3), i & 15);
+      pixels += fb_width - (y & 7) - (y & 3);
+    }
+  }
+  t = micros() - t;
+  report("drawHLine", pixels, t);
+  Serial.println();
+}
+
+void setup() {
+  Serial.begin(9600);
+  while(!Serial);
+
+  vga4bit.stop();
+  // Setup VGA display: 640x480x60
+  //                    double Height = false
+  //                    double Width  = false
+  //                    Color Depth   = 4 bits
+  vga4bit.begin(*timing, false, false, 4);
+  // Get display dimensions
+  vga4bit.getFbSize(&fb_width, &fb_height);
+  vga4bit.clear(VGA_BLACK);
+}
+
+void loop() {
+  runBench();
+  delay(5000);
+}
@@ -91,6 +91,9 @@ void loop() {
 
 void drawGauge(uint16_t x, uint16_t y, uint16_t r) {
   vga4bit.drawCircle(x, y, r, 1, myColors[15]); //draw instrument container
+  // Red zone over the last two major ticks (screen 330 to 390 degrees
+  // clockwise is -30 to 30 degrees counterclockwise).
+  if (r > 15) vga4bit.drawArc(x, y, r - 2, -30, 30, 4, myColors[4]);
   faceHelper(x, y, r, 150, 390, 1.3); //draw major ticks
   if (r > 15) faceHelper(x, y, r, 165, 375, 1.1); //draw minor ticks
 }
@@ -0,0 +1,75 @@
+// Image loading.
+// Shows BMP (4 or 8 bit, uncompressed) and PCX (8 bit,
+// 4 bit or 16 color planar) images from the built in SD
+// card one after another, centered. Each one is decoded
+// straight into the frame buffer a row at a time, so
+// images of any height need no more RAM than one row.
+// Prints the load time of each on the serial monitor.
+
+#include "VGA_4bit_T4.h"
+#include "imagefile.h"
+#include <SD.h>
+
+// Uncomment one of the following screen resolutions. Try them all:)
+//const vga_timing *timing = &t1024x768x60;
+//const vga_timing *timing = &t800x600x60;
+const vga_timing *timing = &t640x480x60;
+//const vga_timing *timing = &t640x400x70;
+
+// Must use this instance name. It's used in the driver.
+FlexIO2VGA vga4bit;
+
+int fb_width, fb_height;
+
+// Decoder state, about 2.5K so not on the stack.
+vga_img_t img;
+
+bool isImage(const char *name) {
+  const char *dot = strrchr(name, '.');
+  return dot && (!strcasecmp(dot, ".bmp") || !strcasecmp(dot, ".pcx"));
+}
+
+void showImage(File &f) {
+  vga_img_reader_t rd;
+  vga_img_file(&rd, &f);
+  if(vga_img_open(&img, &rd) < 0) {
+    Serial.printf("%s: not a supported image\n", f.name());
+    return;
+  }
+  vga4bit.clear(VGA_BLACK);
+  uint32_t t = micros();
+  int err = vga4bit.drawImage((fb_width - img.w) / 2, (fb_height - img.h) / 2, &img);
+  t = micros() - t;
+  Serial.printf("%s: %dx%d %d bit %s, %lu us%s\n", f.name(), img.w, img.h, img.bits,
+                (img.format == VGA_IMG_BMP) ? "BMP" : "PCX", t, (err < 0) ? ", file short" : "");
+  delay(3000);
+}
+
+void setup() {
+  Serial.begin(9600);
+  while(!Serial);
+
+  vga4bit.stop();
+  // Setup VGA display: 640x480x60
+  //                    double Height = false
+  //                    double Width  = false
+  //                    Color Depth   = 4 bits
+  vga4bit.begin(*timing, false, false, 4);
+  // Get display dimensions
+  vga4bit.getFbSize(&fb_width, &fb_height);
+  vga4bit.clear(VGA_BLACK);
+
+  if(!SD.begin(BUILTIN_SDCARD)) {
+    Serial.println("No SD card");
+    while(1);
+  }
+}
+
+void loop() {
+  File dir = SD.open("/");
+  while(File f = dir.openNextFile()) {
+    if(!f.isDirectory() && isImage(f.name())) showImage(f);
+    f.close();
+  }
+  dir.close();
+}
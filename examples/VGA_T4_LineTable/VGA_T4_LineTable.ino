@@ -0,0 +1,71 @@
+// Per scanline table check.
+// Turns on each feature that uses the per scanline table
+// (setLineTable(), attachRaster(), setHardwareScroll() and
+// setLineBuffer()) in the tallest mode, 1024x768, and prints
+// PASS or FAIL for each on the serial monitor. The table is
+// sized from the mode, so all of them must return 0.
+
+#include "VGA_4bit_T4.h"
+
+const vga_timing *timing = &t1024x768x60;
+
+// Must use this instance name. It's used in the driver.
+FlexIO2VGA vga4bit;
+
+int fb_width, fb_height;
+int failures = 0;
+
+volatile uint32_t rasterCalls = 0;
+vga_layers_t layers;
+
+void rasterLine(uint16_t line) {
+  rasterCalls++;
+}
+
+void check(const char *name, bool ok) {
+  Serial.printf("%-40s %s\n", name, ok ? "PASS" : "FAIL");
+  if(!ok) failures++;
+}
+
+void setup() {
+  Serial.begin(9600);
+  while(!Serial);
+
+  vga4bit.stop();
+  // Setup VGA display: 1024x768x60
+  //                    double Height = false
+  //                    double Width  = false
+  //                    Color Depth   = 4 bits
+  check("begin()", vga4bit.begin(*timing, false, false, 4) == 0);
+  vga4bit.getFbSize(&fb_width, &fb_height);
+  vga4bit.clear(VGA_BLACK);
+  for(int y = 0; y < fb_height; y += 16)
+    vga4bit.fillRect(0, y, fb_width - 1, y + 7, (y / 16) & 15);
+
+  check("setLineTable(true)", vga4bit.setLineTable(true) == 0);
+
+  // Last display line, past the old 600 line limit.
+  check("attachRaster(767)", vga4bit.attachRaster(767, rasterLine) == 0);
+  delay(100);
+  check("raster callback runs", rasterCalls > 0);
+  vga4bit.detachRaster(767, rasterLine);
+
+  check("setHardwareScroll(true)", vga4bit.setHardwareScroll(true) == 0);
+  for(int i = 0; i < 20; i++) {
+    vga4bit.scrollUpPrintWindow();
+    delay(20);
+  }
+  check("setHardwareScroll(false)", vga4bit.setHardwareScroll(false) == 0);
+
+  memset(&layers, 0, sizeof(layers));
+  layers.background = VGA_BLUE;
+  check("setLineBuffer(layers)", vga4bit.setLineBuffer(&layers) == 0);
+  delay(1000);
+  check("setLineBuffer(NULL)", vga4bit.setLineBuffer(NULL) == 0);
+
+  check("setLineTable(false)", vga4bit.setLineTable(false) == 0);
+  Serial.printf("%d failures\n", failures);
+}
+
+void loop() {
+}
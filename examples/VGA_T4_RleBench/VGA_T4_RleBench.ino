@@ -0,0 +1,106 @@
+// Sprite benchmark.
+// Draws a set of mostly transparent icons with drawBitmap()
+// (one byte per pixel), drawPacked() (packed with a mask)
+// and drawRle() (run length encoded) and prints the time
+// per icon and the bytes each format takes on the serial
+// monitor. The icons are made in setup() and encoded at
+// run time.
+
+#include "VGA_4bit_T4.h"
+
+// Uncomment one of the following screen resolutions. Try them all:)
+//const vga_timing *timing = &t1024x768x60;
+//const vga_timing *timing = &t800x600x60;
+const vga_timing *timing = &t640x480x60;
+//const vga_timing *timing = &t640x400x70;
+
+// Must use this instance name. It's used in the driver.
+FlexIO2VGA vga4bit;
+
+int fb_width, fb_height;
+
+#define ICONS 4
+#define LOOPS 500
+
+const char *names[ICONS] = { "ring 16", "disc 32", "cross 32", "ring 48" };
+const int sizes[ICONS] = { 16, 32, 32, 48 };
+
+uint8_t *bytes[ICONS];
+vga_packed_t packed[ICONS];
+vga_rle_t rle[ICONS];
+uint32_t rleSize[ICONS];
+
+// Make icon i, one byte per pixel with 0 transparent.
+void makeIcon(int i, uint8_t *p, int n) {
+  int c = n / 2;
+  for(int y = 0; y < n; y++) {
+    for(int x = 0; x < n; x++) {
+      int dx = x - c, dy = y - c;
+      int d2 = dx * dx + dy * dy;
+      uint8_t v = 0;
+      switch(i) {
+        case 0:
+        case 3: // Two tone ring.
+          if((d2 <= c * c) && (d2 >= (c - 3) * (c - 3))) v = (dy < 0) ? VGA_BRIGHT_WHITE : VGA_WHITE;
+          break;
+        case 1: // Disc with a highlight.
+          if(d2 <= c * c) v = ((dx + dy) < -c / 2) ? VGA_BRIGHT_CYAN : VGA_CYAN;
+          break;
+        case 2: // Cross with a border.
+          if((abs(dx) <= 3) || (abs(dy) <= 3)) v = ((abs(dx) == 3) || (abs(dy) == 3)) ? VGA_GREY : VGA_BRIGHT_RED;
+          break;
+      }
+      *p++ = v;
+    }
+  }
+}
+
+void setup() {
+  Serial.begin(9600);
+  while(!Serial);
+
+  vga4bit.stop();
+  // Setup VGA display: 640x480x60
+  //                    double Height = false
+  //                    double Width  = false
+  //                    Color Depth   = 4 bits
+  vga4bit.begin(*timing, false, false, 4);
+  // Get display dimensions
+  vga4bit.getFbSize(&fb_width, &fb_height);
+  vga4bit.clear(VGA_BLUE);
+
+  for(int i = 0; i < ICONS; i++) {
+    int n = sizes[i];
+    bytes[i] = (uint8_t *)malloc(n * n);
+    makeIcon(i, bytes[i], n);
+    uint32_t size = vga_packed_size(n, n, true);
+    vga_packed_from_bytes(&packed[i], malloc(size), size, bytes[i], n, n, true);
+    rleSize[i] = vga_rle_encode(NULL, NULL, 0, bytes[i], n, n);
+    vga_rle_encode(&rle[i], malloc(rleSize[i]), rleSize[i], bytes[i], n, n);
+  }
+}
+
+void report(const char *name, const char *how, uint32_t us, uint32_t size) {
+  Serial.printf("%-10s %-12s %8.2f us/icon %6lu bytes\n", name, how, (float)us / LOOPS, size);
+}
+
+void loop() {
+  uint32_t t;
+  for(int i = 0; i < ICONS; i++) {
+    int n = sizes[i];
+    // Odd x so the unaligned paths are timed.
+    t = micros();
+    for(int j = 0; j < LOOPS; j++) vga4bit.drawBitmap(1 + (j % 16) * 37, 11, bytes[i], n, n);
+    report(names[i], "drawBitmap", micros() - t, n * n);
+
+    t = micros();
+    for(int j = 0; j < LOOPS; j++) vga4bit.drawPacked(1 + (j % 16) * 37, 81, &packed[i]);
+    report(names[i], "drawPacked", micros() - t, vga_packed_size(n, n, true));
+
+    t = micros();
+    for(int j = 0; j < LOOPS; j++) vga4bit.drawRle(1 + (j % 16) * 37, 151, &rle[i]);
+    report(names[i], "drawRle", micros() - t, rleSize[i]);
+  }
+  Serial.println();
+  delay(5000);
+}
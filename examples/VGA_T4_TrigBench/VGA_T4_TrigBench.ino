@@ -0,0 +1,122 @@
+// Fixed point trig benchmark.
+// Prints on the serial monitor how far vga_sin() and the old
+// whole degree calcsi[] table are from sinf(), and how long
+// each takes. Then a polygon is rotated the old way (atan2f,
+// sqrtf, cosf and sinf per point) and with a fixed point
+// affine transform, and rotated quads are drawn with both.
+
+#include "VGA_4bit_T4.h"
+#include "fixtrig.h"
+
+// Uncomment one of the following screen resolutions. Try them all:)
+//const vga_timing *timing = &t1024x768x60;
+//const vga_timing *timing = &t800x600x60;
+const vga_timing *timing = &t640x480x60;
+//const vga_timing *timing = &t640x400x70;
+
+// Must use this instance name. It's used in the driver.
+FlexIO2VGA vga4bit;
+
+int fb_width, fb_height;
+
+#define LOOPS 100000
+#define POINTS 64
+
+volatile int32_t isink;
+volatile float fsink;
+
+Point2D shape[POINTS];
+
+void report(const char *name, uint32_t calls, uint32_t us) {
+  Serial.printf("%-24s %8lu calls %8lu us %8.1f ns/call\n", name,
+                calls, us, us * 1000.0f / calls);
+}
+
+void accuracy() {
+  float worst = 0, worstTable = 0;
+  for(uint32_t a = 0; a < VGA_ANGLE_TURN; a++) {
+    float ref = sinf(a * (2 * PI / VGA_ANGLE_TURN));
+    float e = fabsf(vga_sin(a) / (float)VGA_Q15_ONE - ref);
+    if(e > worst) worst = e;
+    // The nearest whole degree below, as drawQuad() used.
+    float t = fabsf(calcsi[(a * 360) / VGA_ANGLE_TURN] - ref);
+    if(t > worstTable) worstTable = t;
+  }
+  Serial.printf("vga_sin()  max error %.7f\n", worst);
+  Serial.printf("calcsi[]   max error %.7f\n", worstTable);
+}
+
+void speed() {
+  uint32_t t;
+
+  t = micros();
+  for(int i = 0; i < LOOPS; i++) fsink = sinf(i * (2 * PI / VGA_ANGLE_TURN));
+  report("sinf", LOOPS, micros() - t);
+
+  t = micros();
+  for(int i = 0; i < LOOPS; i++) fsink = calcsi[i % 360];
+  report("calcsi[]", LOOPS, micros() - t);
+
+  t = micros();
+  for(int i = 0; i < LOOPS; i++) isink = vga_sin(i);
+  report("vga_sin", LOOPS, micros() - t);
+}
+
+void rotation() {
+  uint32_t t;
+  int loops = LOOPS / POINTS;
+  int32_t x, y;
+
+  t = micros();
+  for(int i = 0; i < loops; i++) {
+    for(int n = 0; n < POINTS; n++) {
+      float d = sqrtf(shape[n].x * shape[n].x + shape[n].y * shape[n].y);
+      float a = atan2f(shape[n].y, shape[n].x) + i * (PI / 180);
+      isink = (int32_t)(cosf(a) * d) + (int32_t)(sinf(a) * d);
+    }
+  }
+  report("float rotate", loops * POINTS, micros() - t);
+
+  t = micros();
+  for(int i = 0; i < loops; i++) {
+    vga_affine_t m;
+    vga_affine_rotate(&m, vga_deg(i));
+    for(int n = 0; n < POINTS; n++) {
+      vga_affine_apply(&m, shape[n].x, shape[n].y, &x, &y);
+      isink = x + y;
+    }
+  }
+  report("affine rotate", loops * POINTS, micros() - t);
+
+  t = micros();
+  for(int i = 0; i < 360; i++) vga4bit.fillQuad(fb_width / 2, fb_height / 2, 200, 100, i, i & 15);
+  report("fillQuad 200x100", 360, micros() - t);
+}
+
+void setup() {
+  Serial.begin(9600);
+  while(!Serial);
+
+  vga4bit.stop();
+  // Setup VGA display: 640x480x60
+  //                    double Height = false
+  //                    double Width  = false
+  //                    Color Depth   = 4 bits
+  vga4bit.begin(*timing, false, false, 4);
+  // Get display dimensions
+  vga4bit.getFbSize(&fb_width, &fb_height);
+  vga4bit.clear(VGA_BLACK);
+
+  for(int n = 0; n < POINTS; n++) {
+    shape[n].x = random(-200, 200);
+    shape[n].y = random(-200, 200);
+  }
+}
+
+void loop() {
+  accuracy();
+  speed();
+  rotation();
+  Serial.println();
+  delay(5000);
+}
@@ -29,6 +29,15 @@
 #include "VGA_T4_Config.h"
 #include "font_8x8.h"
 #include "font_8x16.h"
+#include "scanline.h"
+#include "linebuf.h"
+#include "span.h"
+#include "blit.h"
+#include "nibble.h"
+#include "line.h"
+#include "fixtrig.h"
+#include "packed.h"
+#include "rle.h"
 
 //==============================================
 // Original version of the 4 bit VGA DAC ladder.
@@ -58,24 +67,366 @@
  * HSYNC (35) <---------------68R---------------------------> VGA PIN 13 - T4 pin 35
  */
 
-// Frame buffer configurations. Un-comment one at a time.
-DMAMEM uint8_t frameBuffer0[(MAX_HEIGHT+1)*(MAX_WIDTH+STRIDE_PADDING)];
-//uint8_t frameBuffer0[(MAX_HEIGHT+1)*(MAX_WIDTH+STRIDE_PADDING)];
-//EXTMEM uint8_t frameBuffer0[(MAX_HEIGHT+1)*(MAX_WIDTH+STRIDE_PADDING)];
-//static uint8_t frameBuffer1[(MAX_HEIGHT+1)*(MAX_WIDTH+STRIDE_PADDING)];
-
-static uint8_t* const s_frameBuffer[1] = {frameBuffer0};
-
-static uint32_t frameBufferIndex = 0;
+// Precomputed sinus and cosinus table from 0 to 359 degrees
+// The tables are in Degrees not in Radian !
+const float calcsi[360]={
+ 0.000001 ,                                                                                                                            //  0
+ 0.01745239 , 0.03489947 , 0.05233591 , 0.06975641 , 0.08715567 , 0.1045284 , 0.1218692 , 0.139173 , 0.1564343 , 0.173648 ,            // 1 à  10
+ 0.1908088 , 0.2079115 , 0.2249509 , 0.2419217 , 0.2588188 , 0.2756371 , 0.2923715 , 0.3090167 , 0.3255679 , 0.3420198 ,               // 11 à  20
+ 0.3583677 , 0.3746063 , 0.3907308 , 0.4067363 , 0.4226179 , 0.4383708 , 0.4539901 , 0.4694712 , 0.4848093 , 0.4999996 ,               // 21 à  30
+ 0.5150377 , 0.5299189 , 0.5446386 , 0.5591925 , 0.573576 , 0.5877848 , 0.6018146 , 0.615661 , 0.62932 , 0.6427872 ,                   // 31 à  40
+ 0.6560586 , 0.6691301 , 0.6819978 , 0.6946579 , 0.7071063 , 0.7193394 , 0.7313532 , 0.7431444 , 0.7547091 , 0.7660439 ,               // 41 à  50
+ 0.7771455 , 0.7880103 , 0.798635 , 0.8090165 , 0.8191515 , 0.8290371 , 0.8386701 , 0.8480476 , 0.8571668 , 0.8660249 ,                // 51 à  60
+ 0.8746193 , 0.8829472 , 0.8910061 , 0.8987936 , 0.9063074 , 0.913545 , 0.9205045 , 0.9271835 , 0.9335801 , 0.9396922 ,                // 61 à  70
+ 0.9455183 , 0.9510562 , 0.9563044 , 0.9612614 , 0.9659255 , 0.9702954 , 0.9743698 , 0.9781474 , 0.981627 , 0.9848075 ,                // 71 à  80
+ 0.9876881 , 0.9902679 , 0.992546 , 0.9945218 , 0.9961946 , 0.9975639 , 0.9986295 , 0.9993908 , 0.9998476 , 0.99999 ,                  // 81 à  90
+ 0.9998477 , 0.9993909 , 0.9986296 , 0.9975642 , 0.9961948 , 0.994522 , 0.9925463 , 0.9902682 , 0.9876886 , 0.984808 ,                 // 91 à  100
+ 0.9816275 , 0.9781479 , 0.9743704 , 0.9702961 , 0.9659262 , 0.9612621 , 0.9563052 , 0.9510571 , 0.9455191 , 0.9396932 ,               // 101 à  110
+ 0.933581 , 0.9271844 , 0.9205055 , 0.9135461 , 0.9063086 , 0.8987948 , 0.8910073 , 0.8829485 , 0.8746206 , 0.8660263 ,                // 111 à  120
+ 0.8571682 , 0.8480491 , 0.8386716 , 0.8290385 , 0.8191531 , 0.8090182 , 0.7986366 , 0.7880119 , 0.7771472 , 0.7660457 ,               // 121 à  130
+ 0.7547108 , 0.7431462 , 0.7313551 , 0.7193412 , 0.7071083 , 0.6946598 , 0.6819999 , 0.6691321 , 0.6560606 , 0.6427892 ,               // 131 à  140
+ 0.629322 , 0.6156631 , 0.6018168 , 0.5877869 , 0.5735782 , 0.5591948 , 0.5446408 , 0.5299212 , 0.5150401 , 0.5000019 ,                // 141 à  150
+ 0.4848116 , 0.4694737 , 0.4539925 , 0.4383733 , 0.4226205 , 0.4067387 , 0.3907333 , 0.3746087 , 0.3583702 , 0.3420225 ,               // 151 à  160
+ 0.3255703 , 0.3090193 , 0.2923741 , 0.2756396 , 0.2588214 , 0.2419244 , 0.2249534 , 0.2079142 , 0.1908116 , 0.1736506 ,               // 161 à  170
+ 0.156437 , 0.1391758 , 0.1218719 , 0.1045311 , 0.08715825 , 0.06975908 , 0.05233867 , 0.03490207 , 0.01745508 , 0.0277 ,              // 171 à  180
+ -0.01744977 , -0.03489676 , -0.05233313 , -0.06975379 , -0.08715296 , -0.1045256 , -0.1218666 , -0.1391703 , -0.1564316 , -0.1736454 ,// 181 à  190
+ -0.1908061 , -0.207909 , -0.2249483 , -0.241919 , -0.2588163 , -0.2756345 , -0.2923688 , -0.3090142 , -0.3255653 , -0.3420173 ,       // 191 à  200
+ -0.3583652 , -0.3746038 , -0.3907282 , -0.4067339 , -0.4226155 , -0.4383683 , -0.4539878 , -0.4694688 , -0.4848068 , -0.4999973 ,     // 201 à  210
+ -0.5150353 , -0.5299166 , -0.5446364 , -0.5591902 , -0.5735739 , -0.5877826 , -0.6018124 , -0.615659 , -0.6293178 , -0.642785 ,       // 211 à  220
+ -0.6560566 , -0.6691281 , -0.6819958 , -0.694656 , -0.7071043 , -0.7193374 , -0.7313514 , -0.7431425 , -0.7547074 , -0.7660421 ,      // 221 à  230
+ -0.7771439 , -0.7880087 , -0.7986334 , -0.8090149 , -0.8191499 , -0.8290355 , -0.8386687 , -0.8480463 , -0.8571655 , -0.8660236 ,     // 231 à  240
+ -0.8746178 , -0.882946 , -0.8910049 , -0.8987925 , -0.9063062 , -0.9135439 , -0.9205033 , -0.9271825 , -0.9335791 , -0.9396913 ,      // 241 à  250
+ -0.9455173 , -0.9510553 , -0.9563036 , -0.9612607 , -0.9659248 , -0.9702948 , -0.9743692 , -0.9781467 , -0.9816265 , -0.9848071 ,     // 251 à  260
+ -0.9876878 , -0.9902675 , -0.9925456 , -0.9945215 , -0.9961944 , -0.9975638 , -0.9986293 , -0.9993907 , -0.9998476 , -0.99999 ,       // 261 à  270
+ -0.9998478 , -0.9993909 , -0.9986298 , -0.9975643 , -0.9961951 , -0.9945223 , -0.9925466 , -0.9902686 , -0.987689 , -0.9848085 ,      // 271 à  280
+ -0.981628 , -0.9781484 , -0.974371 , -0.9702968 , -0.965927 , -0.9612629 , -0.9563061 , -0.9510578 , -0.9455199 , -0.9396941 ,        // 281 à  290
+ -0.933582 , -0.9271856 , -0.9205065 , -0.9135472 , -0.9063097 , -0.898796 , -0.8910086 , -0.8829498 , -0.8746218 , -0.8660276 ,       // 291 à  300
+ -0.8571696 , -0.8480505 , -0.8386731 , -0.8290402 , -0.8191546 , -0.8090196 , -0.7986383 , -0.7880136 , -0.777149 , -0.7660476 ,      // 301 à  310
+ -0.7547125 , -0.7431479 , -0.7313569 , -0.7193431 , -0.7071103 , -0.6946616 , -0.6820017 , -0.6691341 , -0.6560627 , -0.6427914 ,     // 311 à  320
+ -0.6293243 , -0.6156651 , -0.6018188 , -0.5877892 , -0.5735805 , -0.5591971 , -0.5446434 , -0.5299233 , -0.5150422 , -0.5000043 ,     // 321 à  330
+ -0.484814 , -0.4694761 , -0.4539948 , -0.4383755 , -0.4226228 , -0.4067413 , -0.3907359 , -0.3746115 , -0.3583725 , -0.3420248 ,      // 331 à  340
+ -0.325573 , -0.3090219 , -0.2923768 , -0.2756425 , -0.2588239 , -0.2419269 , -0.2249561 , -0.2079169 , -0.1908143 , -0.1736531 ,      // 341 à  350
+ -0.1564395 , -0.1391783 , -0.1218746 , -0.1045339 , -0.08716125 , -0.06976161 , -0.0523412 , -0.03490484 , -0.01745785 };             // 351 à  359
+
+const float calcco[360]={
+ 0.99999 ,                                                                                                                            //  0
+ 0.9998477 , 0.9993908 , 0.9986295 , 0.9975641 , 0.9961947 , 0.9945219 , 0.9925462 , 0.9902681 , 0.9876884 , 0.9848078 ,              // 1 à  10
+ 0.9816272 , 0.9781477 , 0.9743701 , 0.9702958 , 0.9659259 , 0.9612617 , 0.9563049 , 0.9510566 , 0.9455186 , 0.9396928 ,              // 11 à  20
+ 0.9335806 , 0.927184 , 0.920505 , 0.9135456 , 0.906308 , 0.8987943 , 0.8910067 , 0.8829478 , 0.8746199 , 0.8660256 ,                 // 21 à  30
+ 0.8571675 , 0.8480483 , 0.8386709 , 0.8290379 , 0.8191524 , 0.8090173 , 0.7986359 , 0.7880111 , 0.7771463 , 0.7660448 ,              // 31 à  40
+ 0.75471 , 0.7431452 , 0.7313541 , 0.7193403 , 0.7071072 , 0.6946589 , 0.6819989 , 0.6691311 , 0.6560596 , 0.6427882 ,                // 41 à  50
+ 0.629321 , 0.6156621 , 0.6018156 , 0.5877859 , 0.5735771 , 0.5591936 , 0.5446398 , 0.52992 , 0.5150389 , 0.5000008 ,                 // 51 à  60
+ 0.4848104 , 0.4694724 , 0.4539914 , 0.438372 , 0.4226191 , 0.4067376 , 0.3907321 , 0.3746075 , 0.3583689 , 0.3420211 ,               // 61 à  70
+ 0.3255692 , 0.309018 , 0.2923728 , 0.2756384 , 0.2588201 , 0.241923 , 0.2249522 , 0.2079128 , 0.1908101 , 0.1736494 ,                // 71 à  80
+ 0.1564357 , 0.1391743 , 0.1218706 , 0.1045297 , 0.08715699 , 0.06975782 , 0.05233728 , 0.0349008 , 0.01745369 , 0.0138 ,             // 81 à  90
+ -0.01745104 , -0.03489815 , -0.05233451 , -0.06975505 , -0.08715434 , -0.1045271 , -0.1218679 , -0.1391717 , -0.156433 , -0.1736467 ,// 91 à  100
+ -0.1908075 , -0.2079102 , -0.2249495 , -0.2419204 , -0.2588175 , -0.2756359 , -0.2923701 , -0.3090155 , -0.3255666 , -0.3420185 ,    // 101 à  110
+ -0.3583664 , -0.3746051 , -0.3907295 , -0.4067351 , -0.4226166 , -0.4383696 , -0.4539889 , -0.4694699 , -0.4848081 , -0.4999984 ,    // 111 à  120
+ -0.5150366 , -0.5299177 , -0.5446375 , -0.5591914 , -0.5735749 , -0.5877837 , -0.6018136 , -0.6156599 , -0.6293188 , -0.6427862 ,    // 121 à  130
+ -0.6560575 , -0.669129 , -0.6819969 , -0.6946569 , -0.7071053 , -0.7193384 , -0.7313522 , -0.7431435 , -0.7547083 , -0.7660431 ,     // 131 à  140
+ -0.7771447 , -0.7880094 , -0.7986342 , -0.8090158 , -0.8191508 , -0.8290363 , -0.8386694 , -0.8480469 , -0.8571661 , -0.8660243 ,    // 141 à  150
+ -0.8746186 , -0.8829465 , -0.8910055 , -0.898793 , -0.9063068 , -0.9135445 , -0.9205039 , -0.927183 , -0.9335796 , -0.9396918 ,      // 151 à  160
+ -0.9455178 , -0.9510558 , -0.956304 , -0.9612611 , -0.9659252 , -0.9702951 , -0.9743695 , -0.978147 , -0.9816267 , -0.9848073 ,      // 161 à  170
+ -0.9876879 , -0.9902677 , -0.9925459 , -0.9945216 , -0.9961945 , -0.9975639 , -0.9986294 , -0.9993907 , -0.9998476 , -0.99999 ,      // 171 à  180
+ -0.9998477 , -0.9993909 , -0.9986297 , -0.9975642 , -0.9961949 , -0.9945222 , -0.9925465 , -0.9902685 , -0.9876888 , -0.9848083 ,    // 181 à  190
+ -0.9816277 , -0.9781482 , -0.9743707 , -0.9702965 , -0.9659266 , -0.9612625 , -0.9563056 , -0.9510574 , -0.9455196 , -0.9396937 ,    // 191 à  200
+ -0.9335815 , -0.927185 , -0.9205061 , -0.9135467 , -0.9063091 , -0.8987955 , -0.8910079 , -0.8829491 , -0.8746213 , -0.866027 ,      // 201 à  210
+ -0.857169 , -0.8480497 , -0.8386723 , -0.8290394 , -0.8191538 , -0.8090189 , -0.7986375 , -0.7880127 , -0.7771481 , -0.7660466 ,     // 211 à  220
+ -0.7547117 , -0.743147 , -0.731356 , -0.7193421 , -0.7071092 , -0.6946609 , -0.6820008 , -0.6691331 , -0.6560616 , -0.6427905 ,      // 221 à  230
+ -0.6293229 , -0.6156641 , -0.6018178 , -0.5877882 , -0.5735794 , -0.5591961 , -0.5446419 , -0.5299222 , -0.5150412 , -0.5000032 ,    // 231 à  240
+ -0.4848129 , -0.4694746 , -0.4539936 , -0.4383744 , -0.4226216 , -0.4067401 , -0.3907347 , -0.3746099 , -0.3583714 , -0.3420237 ,    // 241 à  250
+ -0.3255718 , -0.3090207 , -0.2923756 , -0.2756409 , -0.2588227 , -0.2419256 , -0.2249549 , -0.2079156 , -0.1908126 , -0.1736519 ,    // 251 à  260
+ -0.1564383 , -0.139177 , -0.1218734 , -0.1045326 , -0.08715951 , -0.06976035 , -0.05233994 , -0.03490358 , -0.01745659 , -0.0427 ,   // 261 à  270
+ 0.01744851 , 0.0348955 , 0.05233186 , 0.06975229 , 0.08715146 , 0.1045246 , 0.1218654 , 0.139169 , 0.1564303 , 0.1736439 ,           // 271 à  280
+ 0.1908047 , 0.2079078 , 0.224947 , 0.2419178 , 0.2588149 , 0.2756331 , 0.2923674 , 0.309013 , 0.3255641 , 0.3420161 ,                // 281 à  290
+ 0.3583638 , 0.3746024 , 0.3907273 , 0.4067327 , 0.4226143 , 0.4383671 , 0.4539864 , 0.4694674 , 0.4848059 , 0.4999962 ,              // 291 à  300
+ 0.5150342 , 0.5299154 , 0.5446351 , 0.559189 , 0.5735728 , 0.5877816 , 0.6018113 , 0.6156578 , 0.6293167 , 0.6427839 ,               // 301 à  310
+ 0.6560556 , 0.6691272 , 0.6819949 , 0.6946549 , 0.7071033 , 0.7193366 , 0.7313506 , 0.7431416 , 0.7547064 , 0.7660413 ,              // 311 à  320
+ 0.7771428 , 0.7880079 , 0.7986327 , 0.8090141 , 0.8191492 , 0.8290347 , 0.8386678 , 0.8480456 , 0.8571648 , 0.8660229 ,              // 321 à  330
+ 0.8746172 , 0.8829452 , 0.8910043 , 0.8987919 , 0.9063057 , 0.9135434 , 0.9205029 , 0.9271819 , 0.9335786 , 0.9396909 ,              // 331 à  340
+ 0.9455169 , 0.9510549 , 0.9563032 , 0.9612602 , 0.9659245 , 0.9702945 , 0.9743689 , 0.9781465 , 0.9816261 , 0.9848069 ,              // 341 à  350
+ 0.9876875 , 0.9902673 , 0.9925455 , 0.9945213 , 0.9961942 , 0.9975637 , 0.9986292 , 0.9993906 , 0.9998476 };                         // 351 à  359
+
+//**************************************************************//
+// Graphic cursor images, packed 8x16 with a mask (see packed.h).
+// Image 0 is the block cursor, it is drawn with fillRect().
+//**************************************************************//
+static const uint8_t arrowPixels[3][64] = {
+  // Graphic Cursor Image 1 (Solid White Arrow)
+  {
+   0X0f,0X00,0X00,0X00,
+   0Xff,0X00,0X00,0X00,
+   0Xff,0X00,0X00,0X00,
+   0Xff,0X0f,0X00,0X00,
+   0Xff,0Xff,0X00,0X00,
+   0Xff,0Xff,0X00,0X00,
+   0Xff,0Xff,0X0f,0X00,
+   0Xff,0Xff,0X0f,0X00,
+   0Xff,0Xff,0Xff,0X00,
+   0Xff,0Xff,0Xff,0X0f,
+   0Xff,0Xff,0Xff,0X00,
+   0Xff,0Xff,0X0f,0X00,
+   0Xff,0Xf0,0X0f,0X00,
+   0X0f,0Xf0,0X0f,0X00,
+   0X00,0X00,0Xff,0X00,
+   0X00,0X00,0Xff,0X00
+  },
+  // Graphic Cursor Image 2 (Hollow Arrow)
+  {
+   0X0f,0X00,0X00,0X00,
+   0Xff,0X00,0X00,0X00,
+   0Xff,0X00,0X00,0X00,
+   0X0f,0X0f,0X00,0X00,
+   0X0f,0Xf0,0X00,0X00,
+   0X0f,0Xf0,0X00,0X00,
+   0X0f,0X00,0X0f,0X00,
+   0X0f,0X00,0X0f,0X00,
+   0X0f,0X00,0Xf0,0X0f,
+   0X0f,0X00,0Xf0,0X0f,
+   0X0f,0X00,0Xff,0X00,
+   0X0f,0Xff,0X0f,0X00,
+   0Xff,0Xff,0X0f,0X00,
+   0X0f,0Xf0,0X0f,0X00,
+   0X00,0X00,0Xff,0X00,
+   0X00,0X00,0Xff,0X00
+  },
+  // Graphic Cursor Image 3 (I-beam)
+  {
+   0X00,0X00,0X00,0X00,
+   0Xff,0Xff,0X0f,0X00,
+   0X00,0X0f,0X00,0X00,
+   0X00,0X0f,0X00,0X00,
+   0X00,0X0f,0X00,0X00,
+   0X00,0X0f,0X00,0X00,
+   0X00,0X0f,0X00,0X00,
+   0X00,0X0f,0X00,0X00,
+   0X00,0X0f,0X00,0X00,
+   0X00,0X0f,0X00,0X00,
+   0X00,0X0f,0X00,0X00,
+   0X00,0X0f,0X00,0X00,
+   0X00,0X0f,0X00,0X00,
+   0X00,0X0f,0X00,0X00,
+   0Xff,0Xff,0X0f,0X00,
+   0X00,0X00,0X00,0X00
+  }
+};
+
+static const uint8_t arrowMask[3][16] = {
+  { 0X01,0X03,0X03,0X07,0X0f,0X0f,0X1f,0X1f,0X3f,0X7f,0X3f,0X1f,0X1b,0X19,0X30,0X30 }, // Image 1
+  { 0X01,0X03,0X03,0X05,0X09,0X09,0X11,0X11,0X61,0X61,0X31,0X1d,0X1f,0X19,0X30,0X30 }, // Image 2
+  { 0X00,0X1f,0X04,0X04,0X04,0X04,0X04,0X04,0X04,0X04,0X04,0X04,0X04,0X04,0X1f,0X00 } // Image 3
+};
+
+static const vga_packed_t arrow[] = {
+  {0, 0, 0, 0, NULL, NULL}, // Image 0 reserved for block cursor.
+  {8, 16, 4, 1, arrowPixels[0], arrowMask[0]},
+  {8, 16, 4, 1, arrowPixels[1], arrowMask[1]},
+  {8, 16, 4, 1, arrowPixels[2], arrowMask[2]}
+};
+
+// Frame buffers, allocated by begin() to fit the mode (see fbAlloc()).
+static uint8_t *s_frameBuffer[FB_COUNT];   // 32 byte aligned buffers.
+static void *s_fbAlloc[FB_COUNT];          // Allocated blocks, NULL if none.
+static uint8_t fbMem = VGA_MEM_DMAMEM;     // Memory buffers come from.
+static size_t fbBytes = 0;                 // Bytes per buffer.
+#if FB_DTCM_SIZE > 0
+static uint8_t dtcmPool[FB_DTCM_SIZE] __attribute__((aligned(32)));
+#endif
+
+static uint32_t frameBufferIndex = 0;       // Buffer being drawn into.
+static volatile uint32_t displayIndex = 0;  // Buffer being scanned out.
+static volatile int32_t pendingIndex = -1;  // Buffer to show at next vblank, -1 = none.
+static uint8_t numBuffers = 1;              // Buffers in use (1 to FB_COUNT).
+
+// Dirty row tracking for data cache flushing. Each frame buffer is split
+// into (up to) 32 bands of 1<<dirtyShift rows. Drawing sets the band bits
+// and only those bands are flushed at vblank.
+static volatile uint32_t dirtyBands[FB_COUNT];
+static uint8_t dirtyShift = 5;
+static volatile uint32_t frameFlushBytes = 0; // Flushed so far this frame.
+static volatile uint32_t lastFlushBytes = 0;  // Flushed during last frame.
+
+// Per scanline TCD table, one entry per displayed line (see scanline.h).
+// Allocated by setLineTable() to fit the mode and freed when the table
+// is turned off, so it costs nothing unless used. The heap is cached, so
+// entries are flushed with lineFlush() after they are changed.
+static vga_tcd_t *lineTcd = NULL;
+static void *lineTcdAlloc = NULL;
+static uint16_t lineTcdLines = 0;   // Entries allocated.
+static uint16_t scanLines = 0;      // Displayed lines in current mode.
+static uint32_t lineTableBase = 0;  // Buffer the table was last mapped to.
+
+// Line buffer scanout. Display rows alternate between two line
+// buffers (in RAM1, not cached) and each row is composed from
+// lbLayers while the row before it is shown.
+#define LINEBUF_BYTES (((LINEBUF_WIDTH / 2) + 31) & ~31)
+static uint8_t lineBuf[2][LINEBUF_BYTES] __attribute__((aligned(32)));
+static vga_layers_t *lbLayers = NULL;
+static uint16_t lbNextRow = 0;  // Next row to compose this frame.
+
+// Raster line callbacks sorted by line. The TCD of each line has
+// INTMAJOR set so dma1 interrupts once that line has been fetched.
+typedef struct {
+  uint16_t line;
+  vga_raster_t callback;
+} raster_irq;
+static raster_irq rasterTable[RASTER_IRQS];
+static uint8_t rasterCount = 0;         // Entries in rasterTable.
+static volatile uint8_t rasterNext = 0; // Next entry to call this frame.
+
+// Vblank callback and job queue. The queue has a single producer
+// (queueJob()) and a single consumer (TimerInterrupt()) so it needs
+// no locking. Head and tail only ever increase.
+typedef struct {
+  vga_job_t job;
+  void *arg;
+} vblank_job;
+static vga_vblank_t vblankCallback = NULL;
+static vblank_job jobQueue[VBLANK_JOBS];
+static volatile uint32_t jobHead = 0; // Next free slot.
+static volatile uint32_t jobTail = 0; // Next job to run.
+static uint32_t jobBudget = 0;        // CPU cycles jobs may use per vblank.
+
+// Asynchronous fills and copies. Queued by queueFill() and
+// copyAsync() and run one at a time on dmafill, each as a 2D
+// transfer: one minor loop per row, with MLOFF stepping to the next
+// row. DmaInterrupt() retires an op and starts the next. Fences are
+// op sequence numbers, an op is done once dmaTail has passed it.
+#define DMA_OP_CURSOR 0x01 // Refresh the cursor underlays when done.
+typedef struct {
+  uint32_t word;      // Fill value, the constant source if src is NULL.
+  const uint8_t *src; // Copy source, first byte of the first row.
+  uint8_t *dst;       // First byte of the first row.
+  uint16_t bytes;    // Bytes per row.
+  uint16_t rows;
+  uint8_t size;      // Transfer size, 1, 2 or 4 bytes.
+  uint8_t flags;
+  vga_job_t done;
+  void *arg;
+} dma_op;
+static dma_op dmaQueue[DMA_OPS];
+static volatile uint32_t dmaHead = 0; // Next free slot.
+static volatile uint32_t dmaTail = 0; // Op running, or next to run.
+static volatile bool dmaRunning = false;
+
+// eDMA channel priority register of channel ch (DCHPRI3..0 are
+// at 0x400E8100..0x400E8103, then 7..4 and so on).
+#define DMA_DCHPRI(ch) (*(volatile uint8_t *)(0x400E8100 + ((ch) ^ 3)))
+#define DMA_DCHPRI_ECP 0x80 // Channel can be preempted.
+
+// Scanout statistics, updated by TimerInterrupt().
+static vga_stats_t vgaStats;
+static uint32_t lastVblank = 0;   // Cycle count at last frame interrupt, 0 = none.
+static uint32_t framePeriod = 0;  // Cycles per frame.
+static uint32_t frameSlack = 0;   // Cycles a frame interrupt may be late.
 static int fb_width;
 static int fb_height;
 static size_t _pitch;  
+
+// Clip rectangle (see pushClipRect()), inclusive corners.
+// Always {0, 0, -1, -1} when empty.
+typedef struct {
+  int16_t x0, y0, x1, y1;
+} clip_rect;
+static clip_rect clipArea = {0, 0, -1, -1};
+static clip_rect clipStack[CLIP_DEPTH];
+static uint8_t clipDepth = 0;
 uint8_t currentFont[256*16] DMAMEM;
 text_cursor tCursor;
 graphic_cursor gCursor;
 
 PolyDef_t PolySet;  // will contain a polygon data
 
+//===============================================
+// Allocate frame buffer 'index' (fbBytes bytes)
+// from fbMem and clear it. Returns -1 if there
+// is not enough memory.
+//===============================================
+static FLASHMEM int fbAlloc(uint32_t index) {
+  uint8_t *buf = NULL;
+  if(s_frameBuffer[index]) return 0;
+  switch(fbMem) {
+    case VGA_MEM_DTCM:
+#if FB_DTCM_SIZE > 0
+      // Fixed slot per buffer.
+      if(((index + 1) * fbBytes) <= FB_DTCM_SIZE)
+        buf = &dtcmPool[index * fbBytes];
+#endif
+      break;
+    case VGA_MEM_PSRAM:
+      // extmem_malloc() falls back to malloc() without PSRAM.
+      if(external_psram_size == 0) break;
+      s_fbAlloc[index] = extmem_malloc(fbBytes + 31);
+      break;
+    case VGA_MEM_NONE:
+      break;
+    default:
+      s_fbAlloc[index] = malloc(fbBytes + 31);
+      break;
+  }
+  if(s_fbAlloc[index])
+    buf = (uint8_t *)(((uintptr_t)s_fbAlloc[index] + 31) & ~(uintptr_t)31);
+  if(buf == NULL) return -1;
+  memset(buf, 0, fbBytes);
+  s_frameBuffer[index] = buf;
+  return 0;
+}
+
+//===============================================
+// Give frame buffer 'index' back to the heap.
+//===============================================
+static FLASHMEM void fbFree(uint32_t index) {
+  if(s_fbAlloc[index]) {
+    if(fbMem == VGA_MEM_PSRAM) extmem_free(s_fbAlloc[index]);
+    else free(s_fbAlloc[index]);
+  }
+  s_fbAlloc[index] = NULL;
+  s_frameBuffer[index] = NULL;
+}
+
+//===============================================
+// True if begin() left no frame buffer to draw
+// into, or was told not to make one.
+//===============================================
+static inline bool noFrameBuffer(void) {
+  return s_frameBuffer[frameBufferIndex] == NULL;
+}
+
+//===============================================
+// Make the scanline table at least 'lines' long.
+// Returns -1 if there is not enough memory.
+//===============================================
+static FLASHMEM int lineTableAlloc(uint16_t lines) {
+  if(lineTcd && (lines <= lineTcdLines)) return 0;
+  free(lineTcdAlloc);
+  lineTcd = NULL;
+  lineTcdLines = 0;
+  lineTcdAlloc = malloc(lines * sizeof(vga_tcd_t) + 31);
+  if(lineTcdAlloc == NULL) return -1;
+  lineTcd = (vga_tcd_t *)(((uintptr_t)lineTcdAlloc + 31) & ~(uintptr_t)31);
+  lineTcdLines = lines;
+  return 0;
+}
+
+//===============================================
+// Give the scanline table back to the heap. The
+// DMA engine must no longer be reading it.
+//===============================================
+static FLASHMEM void lineTableFree(void) {
+  free(lineTcdAlloc);
+  lineTcdAlloc = NULL;
+  lineTcd = NULL;
+  lineTcdLines = 0;
+}
+
+//===============================================
+// Write 'count' changed table entries from
+// 'line' on back to memory for the DMA engine.
+//===============================================
+static inline void lineFlush(uint16_t line, uint16_t count) {
+  arm_dcache_flush(&lineTcd[line], count * sizeof(vga_tcd_t));
+}
+
 //===============================================
 // Start 4 bit VGA display.
 // Params:
@@ -88,9 +439,21 @@ PolyDef_t PolySet;  // will contain a polygon data
 //  bool half_ height - Screen height doubling.
 //  bool half_width.  - Screen width doubling.
 //  bpp: Bits per pixel 1 or 4.
-//         (only 4 bit pixels spported at this time) 
+//         1 bit pixels are shown in the two colors
+//         set with setMonoColors().
+//  mem: Frame buffer memory. One of:
+//         VGA_MEM_DMAMEM (default), VGA_MEM_DTCM
+//         or VGA_MEM_PSRAM. VGA_MEM_DTCM needs
+//         FB_DTCM_SIZE set in VGA_T4_Config.h.
+//         VGA_MEM_NONE makes no frame buffer, for
+//         setLineBuffer() only. Drawing calls then
+//         do nothing.
+// Returns 0, VGA_ERR_MEMORY if the buffers do not
+// fit (display not started) or VGA_ERR_BANDWIDTH
+// if mem can't be read fast enough for the pixel
+// clock (display started but may show errors).
 //===============================================
-FLASHMEM void FlexIO2VGA::begin(const vga_timing& mode, bool half_width, bool half_height, unsigned int bpp) {
+FLASHMEM int FlexIO2VGA::begin(const vga_timing& mode, bool half_width, bool half_height, unsigned int bpp, uint8_t mem) {
   frameCount = 0;
   IOMUXC_SW_MUX_CTL_PAD_GPIO_B0_02 = 4; // FLEXIO2_D2    RED
   IOMUXC_SW_MUX_CTL_PAD_GPIO_B0_01 = 4; // FLEXIO2_D1    GREEN
@@ -109,6 +472,12 @@ FLASHMEM void FlexIO2VGA::begin(const vga_timing& mode, bool half_width, bool ha
   dma_params.TCD->DADDR = &FLEXIO2_SHIFTBUF0;
   dma1.triggerAtHardwareEvent(DMAMUX_SOURCE_FLEXIO2_REQUEST0);
   dma2.triggerAtHardwareEvent(DMAMUX_SOURCE_FLEXIO2_REQUEST0);
+  // Raster line interrupts, only raised in per scanline mode.
+  dma1.attachInterrupt(RasterISR, 48);
+  // Async fills run whenever enabled and give way to scanout.
+  dmafill.triggerContinuously();
+  dmafill.attachInterrupt(DmaISR);
+  DMA_DCHPRI(dmafill.channel) |= DMA_DCHPRI_ECP;
 
   dmaswitcher.TCD->SADDR = dma_chans;
   dmaswitcher.TCD->SOFF = 1;
@@ -120,13 +489,52 @@ FLASHMEM void FlexIO2VGA::begin(const vga_timing& mode, bool half_width, bool ha
 
   double_width = half_width;   // This was missing, added.
   double_height = half_height;
+  if(bpp != 1) bpp = 4;
+  this->bpp = bpp;
   widthxbpp = (mode.width * bpp) / (half_width ? 2 : 1);
   set_clk(4*mode.clk_num, mode.clk_den);
 
   fb_width = mode.width / (double_width ? 2:1);
   fb_height = mode.height / (double_height ? 2:1);
+  scanLines = fb_height * (double_height ? 2:1);
+  line_table = false;
+  hw_scroll = false;
+  lineTableFree();
   _pitch = fb_width*bpp / 8 + STRIDE_PADDING;
 
+  // Allocate buffers for this mode, plus one spare row as before.
+  waitDma();
+  for(int i = 0; i < FB_COUNT; i++) fbFree(i);
+  fbMem = mem;
+  fbBytes = (((fb_height + 1) * _pitch) + 31) & ~31;
+  for(int i = 0; (mem != VGA_MEM_NONE) && (i < numBuffers); i++) {
+    if(fbAlloc(i) < 0) {
+      for(int j = 0; j < FB_COUNT; j++) fbFree(j);
+      // No frame buffer, leave an empty screen so drawing
+      // calls do nothing.
+      fb_width = 0;
+      fb_height = 0;
+      _pitch = 0;
+      resetClipRect();
+      displayIndex = 0;
+      pendingIndex = -1;
+      frameBufferIndex = 0;
+      _fb = NULL;
+      return VGA_ERR_MEMORY;
+    }
+  }
+  displayIndex = 0;
+  pendingIndex = -1;
+  frameBufferIndex = (numBuffers > 1) ? 1:0;
+  _fb = s_frameBuffer[frameBufferIndex];
+  resetClipRect(); // Empty with VGA_MEM_NONE.
+
+  // Smallest band size that covers the frame buffer with 32 bands.
+  dirtyShift = 0;
+  while((fb_height >> dirtyShift) >= 32) dirtyShift++;
+  // Flush everything on the first frame.
+  for(int i = 0; i < FB_COUNT; i++) dirtyBands[i] = 0xffffffff;
+
   FLEXIO2_CTRL = FLEXIO_CTRL_SWRST;
   asm volatile("dsb");
   FLEXIO2_CTRL = FLEXIO_CTRL_FASTACC | FLEXIO_CTRL_FLEXEN;
@@ -203,14 +611,17 @@ FLASHMEM void FlexIO2VGA::begin(const vga_timing& mode, bool half_width, bool ha
 
     // D8 clear = use state 2, D8 set = use state 3
     // note that PWIDTH does not seem to mask D4-7 outputs as documented!
-    FLEXIO2_SHIFTBUF2 = 0x0069A69A;
+    // Top byte of each state is the color output on D0-D7.
+    FLEXIO2_SHIFTBUF2 = 0x0069A69A | (mono_bg << 24);
     FLEXIO2_SHIFTCFG2 = FLEXIO_SHIFTCFG_PWIDTH(15);
     FLEXIO2_SHIFTCTL2 = FLEXIO_SHIFTCTL_TIMSEL(7) | FLEXIO_SHIFTCTL_PINCFG(3) | FLEXIO_SHIFTCTL_PINSEL(8) | FLEXIO_SHIFTCTL_SMOD(6) | FLEXIO_SHIFTCTL_TIMPOL;
-    FLEXIO2_SHIFTBUF3 = 0x0F69A69A;
+    FLEXIO2_SHIFTBUF3 = 0x0069A69A | (mono_fg << 24);
     FLEXIO2_SHIFTCFG3 = FLEXIO_SHIFTCFG_PWIDTH(15);
     FLEXIO2_SHIFTCTL3 = FLEXIO_SHIFTCTL_TIMSEL(7) | FLEXIO_SHIFTCTL_PINCFG(3) | FLEXIO_SHIFTCTL_PINSEL(8) | FLEXIO_SHIFTCTL_SMOD(6) | FLEXIO_SHIFTCTL_TIMPOL;
 
     FLEXIO2_SHIFTSTATE = 2;
+    foreground_color = mono_fg;
+    background_color = mono_bg;
   }
 
   // clear timer 5 status
@@ -233,8 +644,43 @@ FLASHMEM void FlexIO2VGA::begin(const vga_timing& mode, bool half_width, bool ha
 	init_text_settings();
 	initialized = true;
   }
+
+  // Jobs get half of the vertical blanking time by default.
+  // DWT cycle counter times them.
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+  uint32_t htotal = mode.width + mode.hfp + mode.hsw + mode.hbp;
+  uint32_t vblank = mode.vfp + mode.vsw + mode.vbp;
+  setJobBudget((uint32_t)(((uint64_t)vblank * htotal *
+                           mode.clk_den) / (48ULL * mode.clk_num)));
+  // Frame period for the stats. Late is more than a quarter
+  // of the vertical blanking time.
+  framePeriod = (uint32_t)(((uint64_t)(mode.height + vblank) * htotal *
+                            mode.clk_den * (F_CPU_ACTUAL / 1000000)) /
+                           (24ULL * mode.clk_num));
+  frameSlack = (uint32_t)(((uint64_t)framePeriod * vblank) /
+                          ((mode.height + vblank) * 4));
+  resetStats();
+
+  // Scanout rate in KB/s. Pixel clock is 24MHz * clk_num / clk_den.
+  uint32_t rate = (uint32_t)((24000ULL * mode.clk_num * bpp) /
+                             (8ULL * mode.clk_den * (half_width ? 2:1)));
+  uint32_t mbps;
+  switch(mem) {
+    case VGA_MEM_DTCM:  mbps = FB_DTCM_MBPS; break;
+    case VGA_MEM_NONE:  mbps = FB_DTCM_MBPS; break; // Line buffers.
+    case VGA_MEM_PSRAM: mbps = FB_PSRAM_MBPS; break;
+    default:            mbps = FB_DMAMEM_MBPS; break;
+  }
+  if(rate > (mbps * 1000)) return VGA_ERR_BANDWIDTH;
+  return 0;
 }
 
+//===============================================
+// Get number of bytes allocated per frame buffer.
+//===============================================
+uint32_t FlexIO2VGA::getFbBytes(void) { return fbBytes; }
+
 //===================================================
 // Stop display. Used for screen size/params  change.
 //===================================================
@@ -248,6 +694,7 @@ FLASHMEM void FlexIO2VGA::stop(void) {
   }
   dma1.disable();
   dma2.disable();
+  waitDma();
   asm volatile("dsb");
 }
 
@@ -309,9 +756,51 @@ FLASHMEM void FlexIO2VGA::set_clk(int num, int den) {
 // Frame interupt:
 //   Update frame buffer and count.
 //   Procces text cursor if enabled.
+//   Call vblank callback and run queued jobs.
 //===================================================
 void FlexIO2VGA::TimerInterrupt(void) {
-  if (dma_params.TCD->SADDR) {
+  uint32_t start = ARM_DWT_CYCCNT;
+  uint32_t t;
+
+  // Check the time since the last frame interrupt.
+  if(lastVblank) {
+    uint32_t period = start - lastVblank;
+    if(period > (framePeriod + framePeriod/2))
+      vgaStats.missedVblanks += ((period + framePeriod/2) / framePeriod) - 1;
+    else if(period > (framePeriod + frameSlack))
+      vgaStats.lateVblanks++;
+  }
+  lastVblank = start;
+  // Shifter ran out of pixel data during the last frame?
+  uint32_t err = FLEXIO2_SHIFTERR & 0xff;
+  if(err) {
+    FLEXIO2_SHIFTERR = err;
+    vgaStats.shiftErrors++;
+  }
+  // Apply a queued page flip. The frame has been scanned out so the
+  // new buffer is picked up by the DMA setup below.
+  if(pendingIndex >= 0) {
+    displayIndex = pendingIndex;
+    pendingIndex = -1;
+    set_next_buffer(s_frameBuffer[displayIndex], _pitch, false);
+  }
+  // First two rows of a line buffered frame.
+  if(lbLayers) {
+    vga_compose_line(lbLayers, 0, lineBuf[0]);
+    vga_compose_line(lbLayers, 1, lineBuf[1]);
+    lbNextRow = 2;
+  }
+  if (line_table) {
+    // Per scanline mode, the TCD chain handles double height.
+    rasterNext = 0;
+    dma2.disable();
+    memcpy((void *)line_params.TCD, &lineTcd[0], sizeof(vga_tcd_t));
+    dma1 = line_params;
+    dma1.enable();
+    // push first pixels into shiftbuf registers
+    dma1.triggerManual();
+    FLEXIO2_SHIFTSDEN = 1<<0;
+  } else if (dma_params.TCD->SADDR) {
     dma1 = dma_params;
     if (double_height) {
       dma1.disableOnCompletion();
@@ -327,8 +816,10 @@ void FlexIO2VGA::TimerInterrupt(void) {
     FLEXIO2_SHIFTSDEN = 1<<0;
   }
   frameCount++;
-  // Proccess Cursor.
-  if(tCursor.active) {
+  // Proccess Cursor. Only in single buffer mode, otherwise the
+  // cursor would be drawn into the back buffer.
+  t = ARM_DWT_CYCCNT;
+  if(tCursor.active && (numBuffers == 1)) {
     if(tCursor.blink) {
       if(!(frameCount % tCursor.blink_rate)) {
         tCursor.toggle ^= true;
@@ -343,7 +834,131 @@ void FlexIO2VGA::TimerInterrupt(void) {
       drawTcursor(tCursor.color);
     }
   }
+  vgaStats.cursorCycles = ARM_DWT_CYCCNT - t;
+  if(vgaStats.cursorCycles > vgaStats.cursorMaxCycles)
+    vgaStats.cursorMaxCycles = vgaStats.cursorCycles;
+  t = ARM_DWT_CYCCNT;
   fbUpdate(false); // Must be false else endless loop occurs.
+  vgaStats.flushCycles = ARM_DWT_CYCCNT - t;
+  if(vgaStats.flushCycles > vgaStats.flushMaxCycles)
+    vgaStats.flushMaxCycles = vgaStats.flushCycles;
+  lastFlushBytes = frameFlushBytes;
+  frameFlushBytes = 0;
+
+  if(vblankCallback) vblankCallback();
+  // Run queued jobs until the budget is used, the rest wait for
+  // the next vblank.
+  while(jobTail != jobHead) {
+    if((ARM_DWT_CYCCNT - start) >= jobBudget) break;
+    vblank_job *j = &jobQueue[jobTail & (VBLANK_JOBS - 1)];
+    j->job(j->arg);
+    jobTail = jobTail + 1;
+  }
+
+  t = ARM_DWT_CYCCNT - start;
+  vgaStats.frames++;
+  if(t < vgaStats.isrMinCycles) vgaStats.isrMinCycles = t;
+  if(t > vgaStats.isrMaxCycles) vgaStats.isrMaxCycles = t;
+  // Bin 0 is < 4us, then one bin per power of 2.
+  uint32_t us = t / (F_CPU_ACTUAL / 1000000);
+  uint32_t bin = 0;
+  if(us >= 4) {
+    bin = 30 - __builtin_clz(us);
+    if(bin > (VGA_STATS_BINS - 1)) bin = VGA_STATS_BINS - 1;
+  }
+  vgaStats.isrHist[bin]++;
+}
+
+//=====================================================
+// Get a copy of the scanout statistics.
+//=====================================================
+FLASHMEM void FlexIO2VGA::getStats(vga_stats_t *stats) {
+  __disable_irq();
+  *stats = vgaStats;
+  __enable_irq();
+}
+
+//=====================================================
+// Clear the scanout statistics.
+//=====================================================
+FLASHMEM void FlexIO2VGA::resetStats(void) {
+  __disable_irq();
+  memset(&vgaStats, 0, sizeof(vgaStats));
+  vgaStats.isrMinCycles = 0xffffffff;
+  lastVblank = 0;
+  __enable_irq();
+}
+
+//=====================================================
+// Print the scanout statistics on one line. Example:
+// frm=600 err=0 miss=0 late=0 isr=3/41us
+//   hist=590,8,2,0,0,0,0,0 cur=0/2us fl=1/12us
+// isr, cur (cursor) and fl (flush) are last or min/max.
+//=====================================================
+FLASHMEM void FlexIO2VGA::printStats(Print &out) {
+  vga_stats_t st;
+  uint32_t mhz = F_CPU_ACTUAL / 1000000;
+  getStats(&st);
+  if(st.frames == 0) st.isrMinCycles = 0;
+  out.printf("frm=%lu err=%lu miss=%lu late=%lu isr=%lu/%luus hist=",
+             st.frames, st.shiftErrors, st.missedVblanks, st.lateVblanks,
+             st.isrMinCycles / mhz, st.isrMaxCycles / mhz);
+  for(int i = 0; i < VGA_STATS_BINS; i++)
+    out.printf(i ? ",%lu" : "%lu", st.isrHist[i]);
+  out.printf(" cur=%lu/%luus fl=%lu/%luus\n",
+             st.cursorCycles / mhz, st.cursorMaxCycles / mhz,
+             st.flushCycles / mhz, st.flushMaxCycles / mhz);
+}
+
+//=====================================================
+// Wait until frameCount reaches frame. Returns at once
+// if it already has. Handles frameCount wrapping.
+// Example, wait 10 frames:
+//   vga4bit.waitFrame(vga4bit.getFrameCount() + 10);
+//=====================================================
+void FlexIO2VGA::waitFrame(unsigned int frame) {
+  while((int)(frameCount - frame) < 0) yield();
+}
+
+//=====================================================
+// Set a function to be called every vblank, after the
+// next frame has been set up. NULL removes it.
+//=====================================================
+FLASHMEM void FlexIO2VGA::attachVblank(vga_vblank_t callback) {
+  vblankCallback = callback;
+}
+
+//=====================================================
+// Queue job(arg) to run once in the frame interrupt.
+// Jobs run in order, as many per vblank as fit in the
+// budget (see setJobBudget()). Only call this from
+// one context, not from interrupts.
+// Returns false if the queue (VBLANK_JOBS) is full.
+//=====================================================
+bool FlexIO2VGA::queueJob(vga_job_t job, void *arg) {
+  uint32_t head = jobHead;
+  if((head - jobTail) >= VBLANK_JOBS) return false;
+  jobQueue[head & (VBLANK_JOBS - 1)].job = job;
+  jobQueue[head & (VBLANK_JOBS - 1)].arg = arg;
+  // Job must be visible before the ISR can see the new head.
+  asm volatile("dmb" ::: "memory");
+  jobHead = head + 1;
+  return true;
+}
+
+//=====================================================
+// Set time in microseconds the frame interrupt may
+// spend before it stops starting jobs. Timed from the
+// start of the interrupt. A job already started is
+// never cut short. begin() sets half the vertical
+// blanking time of the mode.
+//=====================================================
+FLASHMEM void FlexIO2VGA::setJobBudget(uint32_t us) {
+  jobBudget = us * (F_CPU_ACTUAL / 1000000);
+}
+
+FLASHMEM uint32_t FlexIO2VGA::getJobBudget(void) {
+  return jobBudget / (F_CPU_ACTUAL / 1000000);
 }
 
 //=====================================================
@@ -373,18 +988,347 @@ void FlexIO2VGA::set_next_buffer(const void* source, size_t pitch, bool wait) {
   dma_params.TCD->SADDR = source;
   dma_params.TCD->SLAST = pitch - (major*8);
   dma_params.TCD->CITER = dma_params.TCD->BITER = major;
+  // Lines that showed the old buffer follow it to the new one.
+  if (line_table && ((uint32_t)source != lineTableBase)) {
+    vga_rebase_lines(lineTcd, scanLines, lineTableBase, fb_height*pitch, (uint32_t)source);
+    lineFlush(0, scanLines);
+    lineTableBase = (uint32_t)source;
+  }
   if (wait)
     wait_for_frame();
 }
 
+//=====================================================
+// Enable or disable per scanline scanout. Each
+// displayed line then has its own DMA descriptor (see
+// mapLines() and setLineSource()). Enabling resets the
+// table to show the current buffer and ends line
+// buffer scanout. Takes effect at the next vblank.
+// The table takes 32 bytes of heap per displayed line,
+// allocated when it is enabled and freed when it is
+// disabled. Returns -1 if there is not enough memory
+// for it.
+//=====================================================
+FLASHMEM int FlexIO2VGA::setLineTable(bool enable) {
+  lbLayers = NULL; // Line buffer scanout is rebuilt by setLineBuffer().
+  if(!enable) {
+    if(hw_scroll) setHardwareScroll(false);
+    line_table = false;
+    // The chain is read until the end of this frame.
+    if(lineTcd && NVIC_IS_ENABLED(IRQ_FLEXIO2)) wait_for_frame();
+    lineTableFree();
+    return 0;
+  }
+  if(lineTableAlloc(scanLines) < 0) return -1;
+  vga_tcd_t proto;
+  proto.SOFF = dma_params.TCD->SOFF;
+  proto.ATTR = dma_params.TCD->ATTR;
+  proto.NBYTES = dma_params.TCD->NBYTES;
+  proto.DADDR = (uint32_t)dma_params.TCD->DADDR;
+  proto.DOFF = dma_params.TCD->DOFF;
+  proto.CITER = dma_params.TCD->CITER;
+  proto.BITER = dma_params.TCD->BITER;
+  for(int i = 0; i < scanLines; i++) lineTcd[i].CSR = 0;
+  for(int i = 0; i < rasterCount; i++) {
+    if(rasterTable[i].line < scanLines)
+      lineTcd[rasterTable[i].line].CSR = VGA_TCD_CSR_INTMAJOR;
+  }
+  vga_chain_lines(lineTcd, scanLines, &proto);
+  resetLineTable(); // Flushes the whole table.
+  line_table = true;
+  return 0;
+}
+
+//=====================================================
+// Map every displayed line back to the matching row
+// of the buffer being displayed.
+//=====================================================
+FLASHMEM void FlexIO2VGA::resetLineTable(void) {
+  if(lineTcd == NULL) return;
+  lineTableBase = (uint32_t)s_frameBuffer[displayIndex];
+  if(lineTableBase == 0) {
+    // No frame buffer, show the line buffers until
+    // setLineBuffer() maps them.
+    vga_map_lines(lineTcd, 0, scanLines, (uint32_t)lineBuf[0], LINEBUF_BYTES,
+                  0, 2, double_height ? 2:1);
+  } else {
+    vga_map_lines(lineTcd, 0, scanLines, lineTableBase, _pitch, 0, fb_height,
+                  double_height ? 2:1);
+  }
+  lineFlush(0, scanLines);
+  // Keep the scrolled print window.
+  if(hw_scroll) scrollMap();
+}
+
+//=====================================================
+// Show rows of a buffer on a band of display lines.
+// line, count = first display line and number of lines.
+// base, pitch = buffer and its stride in bytes.
+// row         = row shown on the first line.
+// rows        = rows in buffer, row wraps to 0 after it.
+// Rows are repeated in double height mode.
+// Buffer and pitch must have the same 8 byte alignment
+// as the frame buffer.
+// Examples:
+//   Scroll by 'n' rows without copying:
+//     mapLines(0, lines, fb, pitch, n, height);
+//   Split screen from a second buffer:
+//     mapLines(400, 200, fb2, pitch, 0, 200);
+//=====================================================
+FLASHMEM void FlexIO2VGA::mapLines(uint16_t line, uint16_t count, const void *base,
+                                   size_t pitch, uint16_t row, uint16_t rows) {
+  if((lineTcd == NULL) || (line >= scanLines)) return;
+  if((line + count) > scanLines) count = scanLines - line;
+  vga_map_lines(lineTcd, line, count, (uint32_t)base, pitch, row, rows,
+                double_height ? 2:1);
+  lineFlush(line, count);
+}
+
+//=====================================================
+// Point a single display line at any memory.
+//=====================================================
+void FlexIO2VGA::setLineSource(uint16_t line, const void *source) {
+  if((lineTcd == NULL) || (line >= scanLines)) return;
+  lineTcd[line].SADDR = (uint32_t)source;
+  lineFlush(line, 1);
+}
+
+//=====================================================
+// Show layers (see linebuf.h) instead of the frame
+// buffer. Rows are composed just in time into two
+// line buffers, each row from the DMA interrupt of
+// the row two above it. The frame buffer and drawing
+// methods are left alone and shown again when layers
+// is NULL. layers->width and height are set to the
+// screen size. Layers may be changed at any time,
+// rows not yet composed show the change.
+// Returns -1 in 1 bpp mode, if the screen is wider
+// than LINEBUF_WIDTH or the table can't be used, or
+// for NULL if begin() was given VGA_MEM_NONE.
+//=====================================================
+FLASHMEM int FlexIO2VGA::setLineBuffer(vga_layers_t *layers) {
+  uint8_t repeat = double_height ? 2:1;
+  if(layers == NULL) {
+    if(noFrameBuffer()) return -1; // Nothing to go back to.
+    if(!lbLayers) return 0;
+    __disable_irq();
+    lbLayers = NULL;
+    __enable_irq();
+    // Rebuild the table, keeps raster line interrupts.
+    return setLineTable(true);
+  }
+  if((bpp != 4) || (fb_width > LINEBUF_WIDTH)) return -1;
+  if(hw_scroll) setHardwareScroll(false);
+  if(setLineTable(true) < 0) return -1;
+  layers->width = fb_width;
+  layers->height = fb_height;
+  vga_compose_init();
+  vga_compose_line(layers, 0, lineBuf[0]);
+  vga_compose_line(layers, 1, lineBuf[1]);
+  __disable_irq();
+  vga_map_lines(lineTcd, 0, scanLines, (uint32_t)lineBuf[0], LINEBUF_BYTES,
+                0, 2, repeat);
+  for(int i = repeat - 1; i < scanLines; i += repeat)
+    lineTcd[i].CSR |= VGA_TCD_CSR_INTMAJOR;
+  lineFlush(0, scanLines);
+  lbNextRow = fb_height; // Nothing to compose until the next frame.
+  lbLayers = layers;
+  __enable_irq();
+  return 0;
+}
+
+//=====================================================
+// True while line buffer scanout is on.
+//=====================================================
+bool FlexIO2VGA::getLineBuffer(void) { return lbLayers != NULL; }
+
+//=====================================================
+// Call callback(line) every frame once display line
+// 'line' has been read from the frame buffer, so rows
+// above it can be redrawn without tearing. Runs in
+// the DMA interrupt, keep it short. Turns on the per
+// scanline table if needed.
+// Returns -1 if line is off screen, the table is full
+// (RASTER_IRQS) or the table can't be used.
+//=====================================================
+FLASHMEM int FlexIO2VGA::attachRaster(uint16_t line, vga_raster_t callback) {
+  if((line >= scanLines) || (callback == NULL)) return -1;
+  if(rasterCount >= RASTER_IRQS) return -1;
+  if(!line_table && (setLineTable(true) < 0)) return -1;
+  __disable_irq();
+  // Insert sorted, after entries for the same line.
+  int i = rasterCount;
+  while((i > 0) && (rasterTable[i-1].line > line)) {
+    rasterTable[i] = rasterTable[i-1];
+    i--;
+  }
+  rasterTable[i].line = line;
+  rasterTable[i].callback = callback;
+  rasterCount++;
+  if(rasterNext > i) rasterNext++; // Keep place in the current frame.
+  lineTcd[line].CSR |= VGA_TCD_CSR_INTMAJOR;
+  lineFlush(line, 1);
+  __enable_irq();
+  return 0;
+}
+
+//=====================================================
+// Remove a raster line callback.
+//=====================================================
+FLASHMEM void FlexIO2VGA::detachRaster(uint16_t line, vga_raster_t callback) {
+  bool used = false;
+  __disable_irq();
+  for(int i = 0; i < rasterCount; i++) {
+    if((rasterTable[i].line == line) && (rasterTable[i].callback == callback)) {
+      for(int j = i; j < (rasterCount - 1); j++) rasterTable[j] = rasterTable[j+1];
+      rasterCount--;
+      if(rasterNext > i) rasterNext--;
+      break;
+    }
+  }
+  for(int i = 0; i < rasterCount; i++) {
+    if(rasterTable[i].line == line) used = true;
+  }
+  // Line buffer mode needs the last line of every row.
+  if(lbLayers && ((line % (double_height ? 2:1)) == (double_height ? 1:0)))
+    used = true;
+  if(!used && lineTcd && (line < scanLines)) {
+    lineTcd[line].CSR &= ~VGA_TCD_CSR_INTMAJOR;
+    lineFlush(line, 1);
+  }
+  __enable_irq();
+}
+
+//=====================================================
+// Raster line interrupt:
+//   Call the callbacks of every line fetched so far.
+//   DLASTSGA of the loaded TCD points two lines past
+//   the one that completed, 0 on the last two lines.
+//=====================================================
+void FlexIO2VGA::RasterInterrupt(void) {
+  int32_t line;
+  dma1.clearInterrupt();
+  uint32_t next = (uint32_t)dma1.TCD->DLASTSGA;
+  if(next) {
+    line = (int32_t)((next - (uint32_t)&lineTcd[0]) / sizeof(vga_tcd_t)) - 2;
+  } else {
+    line = dma1.complete() ? scanLines - 1 : scanLines - 2;
+  }
+  // Refill the line buffer(s) already shown, two rows ahead.
+  if(lbLayers) {
+    int32_t last = (line / (double_height ? 2:1)) + 2;
+    if(last >= fb_height) last = fb_height - 1;
+    while(lbNextRow <= last) {
+      vga_compose_line(lbLayers, lbNextRow, lineBuf[lbNextRow & 1]);
+      lbNextRow++;
+    }
+  }
+  while((rasterNext < rasterCount) && (rasterTable[rasterNext].line <= line)) {
+    raster_irq *r = &rasterTable[rasterNext++];
+    r->callback(r->line);
+  }
+}
+
+//=====================================================
+// Set number of frame buffers to use.
+// count = 1 (single), 2 (double) or 3 (triple).
+// New buffers are allocated from the memory given
+// to begin() and unused ones are freed.
+// Returns -1 if count is more than FB_COUNT set in
+// VGA_T4_Config.h or the buffers do not fit.
+//=====================================================
+FLASHMEM int FlexIO2VGA::setBufferCount(uint8_t count) {
+  if((count < 1) || (count > FB_COUNT)) return -1;
+  for(int i = numBuffers; i < count; i++) {
+    if(fbAlloc(i) < 0) {
+      for(int j = numBuffers; j < count; j++) fbFree(j);
+      return -1;
+    }
+    dirtyBands[i] = 0xffffffff;
+  }
+  bool moved = false;
+  // Hardware scroll only works on a single buffer.
+  if((count > 1) && hw_scroll) setHardwareScroll(false);
+  __disable_irq();
+  pendingIndex = -1;
+  if(displayIndex >= count) {
+    displayIndex = 0;
+    set_next_buffer(s_frameBuffer[0], _pitch, false);
+    moved = true;
+  }
+  numBuffers = count;
+  // Draw into the visible buffer if single buffered,
+  // otherwise into the next one.
+  frameBufferIndex = (displayIndex + (count > 1 ? 1:0)) % count;
+  __enable_irq();
+  _fb = s_frameBuffer[frameBufferIndex];
+  // Let the frame showing a dropped buffer finish first.
+  if(moved) wait_for_frame();
+  waitDma();
+  for(int i = count; i < FB_COUNT; i++) fbFree(i);
+  return count;
+}
+
+//-----------------------------------
+// Get number of frame buffers in use.
+//-----------------------------------
+uint8_t FlexIO2VGA::getBufferCount(void) { return numBuffers; }
+
+//=====================================================
+// Queue the back buffer to be displayed at the next
+// vblank and move drawing to a free buffer.
+// Bool wait - if true wait until the flip is done.
+// With double buffering the new back buffer is still
+// on screen until the flip happens. Use wait = true or
+// check flipPending() before drawing into it.
+// Triple buffering never waits for a free buffer.
+// If a queued frame was not shown yet it is dropped
+// and reused as the back buffer.
+// Single buffer mode just calls fbUpdate(wait).
+//=====================================================
+void FlexIO2VGA::swapBuffers(bool wait) {
+  if(numBuffers < 2) {
+    fbUpdate(wait);
+    return;
+  }
+  // Double buffering: only one flip can be queued.
+  if(numBuffers == 2) {
+    while(pendingIndex >= 0) wait_for_frame();
+  }
+  frameFlushBytes += flushDirty(frameBufferIndex);
+  __disable_irq();
+  int32_t dropped = pendingIndex;
+  pendingIndex = frameBufferIndex;
+  if(numBuffers == 2) {
+    frameBufferIndex = displayIndex; // Free after the flip.
+  } else if(dropped >= 0) {
+    frameBufferIndex = dropped;
+  } else {
+    frameBufferIndex = 3 - displayIndex - pendingIndex; // 0+1+2 = 3
+  }
+  __enable_irq();
+  _fb = s_frameBuffer[frameBufferIndex];
+  if(wait) {
+    while(pendingIndex >= 0) wait_for_frame();
+  }
+}
+
+//=====================================================
+// Return true while a flip queued by swapBuffers() has
+// not been applied yet. Does not block.
+//=====================================================
+bool FlexIO2VGA::flipPending(void) { return pendingIndex >= 0; }
+
 //==============================================
 // Select and set screen mode.
+// Returns the same values as begin().
 //==============================================
-FLASHMEM void FlexIO2VGA::setScreenMode(const vga_timing& mode, bool half_height,
-                                         bool half_width, unsigned int bpp) {
+FLASHMEM int FlexIO2VGA::setScreenMode(const vga_timing& mode, bool half_height,
+                                        bool half_width, unsigned int bpp, uint8_t mem) {
   stop();
   tCursorOff();
-  begin(mode,half_height, half_width, bpp);
+  int err = begin(mode,half_height, half_width, bpp, mem);
+  if(err == VGA_ERR_MEMORY) return err;
   print_window_x = 0;
   print_window_y = 0;
   print_window_w = fb_width / font_width;
@@ -392,6 +1336,7 @@ FLASHMEM void FlexIO2VGA::setScreenMode(const vga_timing& mode, bool half_height
   clear(background_color);
   textxy(0,0);
   tCursorOn(); 
+  return err;
 }
 
 //-----------------------
@@ -441,17 +1386,37 @@ FLASHMEM uint16_t  FlexIO2VGA::getTheight(void) { return fb_height/font_height;
 //----------------------------
 FLASHMEM  size_t FlexIO2VGA::getPitch(void) { return _pitch; }
 
+//=====================================================
+// Set the two colors of 1 bit per pixel mode. Set
+// pixels show fg, clear pixels show bg. Changes the
+// whole screen at once, nothing is redrawn. The
+// background color is also output during blanking
+// so black is the safest choice for bg.
+// Also sets the text colors.
+//=====================================================
+FLASHMEM void FlexIO2VGA::setMonoColors(uint8_t fg, uint8_t bg) {
+  // Only D0-D3 are color outputs.
+  mono_fg = fg & 0x0f;
+  mono_bg = bg & 0x0f;
+  foreground_color = mono_fg;
+  background_color = mono_bg;
+  if(bpp == 1) {
+    FLEXIO2_SHIFTBUF2 = 0x0069A69A | (mono_bg << 24);
+    FLEXIO2_SHIFTBUF3 = 0x0069A69A | (mono_fg << 24);
+  }
+}
+
 //===================
 // Clear full screen.
 //===================
 FLASHMEM void FlexIO2VGA::clear(uint8_t fg) {
+  if(noFrameBuffer()) return;
   _fb = s_frameBuffer[frameBufferIndex];
-  uint8_t c = (fg<<4) | fg; 
-  for(int x = 0; x < fb_width; x++) {
-    for(int y = 0; y < fb_height; y++) { 
-      _fb[y*_pitch+x] = c;
-    }
+  for(int y = 0; y < fb_height; y++) { 
+    if(bpp == 1) vga_fill_span1(&_fb[y*_pitch], 0, fb_width-1, monoByte(fg));
+    else vga_fill_span4(&_fb[y*_pitch], 0, fb_width-1, fg);
   }
+  setDirty(0, fb_height-1);
   getChar(tCursorX(),tCursorY(),tCursor.char_under_cursor);
   getGptr(gCursor.gCursor_x,gCursor.gCursor_y,gCursor.char_under_cursor);
 }
@@ -629,14 +1594,25 @@ FLASHMEM int8_t FlexIO2VGA::setBlkCursorDims(uint8_t xStart,
 FLASHMEM void FlexIO2VGA::drawPixel(int16_t x, int16_t y, uint8_t fg) {
   _fb = s_frameBuffer[frameBufferIndex];
 
-  if((x>=0) && (x<=fb_width) && (y>=0) && (y<=fb_height)) {// No neg x or y.
+  if((x >= clipArea.x0) && (x <= clipArea.x1) && (y >= clipArea.y0) && (y <= clipArea.y1)) {
+    if(bpp == 1) {
+      uint8_t bit = 1 << (x & 7); // Pixel x is bit x & 7, LSB first.
+      uint8_t c = getByte(x/8,y); // Get current 8 pixels.
+      c = (c & ~bit) | (monoByte(fg) & bit);
+      y = fbRow(y);
+      _fb[(y*_pitch)+(x/8)] = c;
+      setDirty(y, y);
+      return;
+    }
     unsigned int sel = (x & 1) << 2; // 4 or 0
     uint8_t c = getByte(x/2,y); // Get current 4 bit pixel pair. 
     // remove old color
     c &= (0xf0 >> sel);
     // insert new color
     c |= fg << sel;
+    y = fbRow(y);
     _fb[(y*_pitch)+(x/2)] = c;
+    setDirty(y, y);
   }
 }
 
@@ -648,6 +1624,8 @@ FLASHMEM void FlexIO2VGA::drawPixel(int16_t x, int16_t y, uint8_t fg) {
 //========================================
 FLASHMEM uint8_t FlexIO2VGA::getPixel(uint32_t x, uint32_t y) {
   _fb = s_frameBuffer[frameBufferIndex];
+  if(bpp == 1)
+    return (getByte(x/8,y) & (1 << (x & 7))) ? mono_fg : mono_bg;
   uint8_t c = getByte(x/2,y); // Get current 4 bit pixel pair. 
   // Bit == 0 == 1 then get high nibble else get low nibble.
   if(x & 1) 
@@ -658,21 +1636,162 @@ FLASHMEM uint8_t FlexIO2VGA::getPixel(uint32_t x, uint32_t y) {
     return GET_R_NIBBLE(c);
 }
 
+//==================================================
+// Mark rows y1 to y2 (y1 <= y2, both on screen) of
+// the drawing buffer as dirty.
+// Call after the write so a flush running between
+// the write and this call is never missed.
+//==================================================
+inline void FlexIO2VGA::setDirty(int y1, int y2) {
+  dirtyBands[frameBufferIndex] |= (0xffffffff >> (31 - (y2 >> dirtyShift))) &
+                                  (0xffffffff << (y1 >> dirtyShift));
+}
+
+//==================================================
+// Byte of 8 pixels in a color for 1 bpp mode. Only
+// the background color gives clear pixels.
+//==================================================
+inline uint8_t FlexIO2VGA::monoByte(int color) {
+  return (color == mono_bg) ? 0x00 : 0xff;
+}
+
+//==================================================
+// Translate a screen row to a frame buffer row. Only
+// differs inside a hardware scrolled print window.
+//==================================================
+inline int FlexIO2VGA::fbRow(int y) {
+  if(hw_scroll && ((unsigned)(y - scroll_top) < (unsigned)scroll_rows)) {
+    y += scroll_offset;
+    if(y >= (scroll_top + scroll_rows)) y -= scroll_rows;
+  }
+  return y;
+}
+
+//==================================================
+// Write a pixel to frame buffer row row of _fb. c is
+// monoByte() in 1 bpp mode, else the 4 bit color.
+//==================================================
+inline void FlexIO2VGA::fbPixel(int x, int row, uint8_t c) {
+  if(bpp == 1) {
+    uint8_t bit = 1 << (x & 7);
+    uint8_t *p = &_fb[row*_pitch + (x >> 3)];
+    *p = (*p & ~bit) | (c & bit);
+  } else {
+    int shift = (x & 1) << 2;
+    uint8_t *p = &_fb[row*_pitch + (x >> 1)];
+    *p = (*p & ~(0x0f << shift)) | (c << shift);
+  }
+}
+
+//=====================================================
+// The whole screen, empty if there is no frame buffer
+// so that drawing does nothing.
+//=====================================================
+static clip_rect screenRect(void) {
+  if(noFrameBuffer()) return {0, 0, -1, -1};
+  return {0, 0, (int16_t)(fb_width - 1), (int16_t)(fb_height - 1)};
+}
+
+//=====================================================
+// Push a clip rectangle, the intersection of this one
+// and the current one. Returns -1 if the stack is full.
+//=====================================================
+FLASHMEM int FlexIO2VGA::pushClipRect(int x0, int y0, int x1, int y1) {
+  if(clipDepth >= CLIP_DEPTH) return -1;
+  clipStack[clipDepth++] = clipArea;
+  if(x0 > x1) SWAP(x0, x1);
+  if(y0 > y1) SWAP(y0, y1);
+  if(x0 < clipArea.x0) x0 = clipArea.x0;
+  if(y0 < clipArea.y0) y0 = clipArea.y0;
+  if(x1 > clipArea.x1) x1 = clipArea.x1;
+  if(y1 > clipArea.y1) y1 = clipArea.y1;
+  if((x0 > x1) || (y0 > y1)) {
+    x0 = y0 = 0;
+    x1 = y1 = -1;
+  }
+  clipArea = {(int16_t)x0, (int16_t)y0, (int16_t)x1, (int16_t)y1};
+  return 0;
+}
+
+//=====================================================
+// Go back to the clip rectangle before the last push.
+//=====================================================
+FLASHMEM void FlexIO2VGA::popClipRect(void) {
+  if(clipDepth > 0) clipArea = clipStack[--clipDepth];
+}
+
+//=====================================================
+// Clip to the whole screen and empty the stack.
+//=====================================================
+FLASHMEM void FlexIO2VGA::resetClipRect(void) {
+  clipDepth = 0;
+  clipArea = screenRect();
+}
+
+//=====================================================
+// Get the current clip rectangle. Returns false if it
+// is empty.
+//=====================================================
+FLASHMEM bool FlexIO2VGA::getClipRect(int *x0, int *y0, int *x1, int *y1) {
+  *x0 = clipArea.x0;
+  *y0 = clipArea.y0;
+  *x1 = clipArea.x1;
+  *y1 = clipArea.y1;
+  return clipArea.x0 <= clipArea.x1;
+}
+
+//=====================================================
+// Clip to the whole screen, returning the clip
+// rectangle to put back after. For drawing that is
+// never clipped, such as the cursors.
+//=====================================================
+static clip_rect clipScreen(void) {
+  clip_rect saved = clipArea;
+  clipArea = screenRect();
+  return saved;
+}
+
+//=====================================================
+// Test if a box (x0 <= x1, y0 <= y1) is all outside
+// the clip rectangle.
+//=====================================================
+static inline bool clipOutside(int x0, int y0, int x1, int y1) {
+  return (x1 < clipArea.x0) || (x0 > clipArea.x1) ||
+         (y1 < clipArea.y0) || (y0 > clipArea.y1) ||
+         (clipArea.x1 < clipArea.x0);
+}
+
+//=====================================================
+// Order the corners of a rectangle and clip it.
+// Returns false if nothing is left.
+//=====================================================
+static bool clipBox(int *x0, int *y0, int *x1, int *y1) {
+  if(*x0 > *x1) SWAP(*x0, *x1);
+  if(*y0 > *y1) SWAP(*y0, *y1);
+  if(*x0 < clipArea.x0) *x0 = clipArea.x0;
+  if(*y0 < clipArea.y0) *y0 = clipArea.y0;
+  if(*x1 > clipArea.x1) *x1 = clipArea.x1;
+  if(*y1 > clipArea.y1) *y1 = clipArea.y1;
+  return (*x0 <= *x1) && (*y0 <= *y1);
+}
+
 //=================================
-// clip X to inside horizontal range.
+// clip X to inside horizontal range
+// of the clip rectangle.
 //=================================
 inline int FlexIO2VGA::clip_x(int x) {
-  if(x < 0) return 0;
-  if(x >= fb_width)	return fb_width - 1;
+  if(x < clipArea.x0) return clipArea.x0;
+  if(x > clipArea.x1) return clipArea.x1;
   return x;
 }
 
 //=================================
-// clip Y to inside vertical range.
+// clip Y to inside vertical range
+// of the clip rectangle.
 //=================================
 inline int FlexIO2VGA::clip_y(int y) {
-  if(y < 0) return 0;
-  if(y >= fb_height) return fb_height - 1;
+  if(y < clipArea.y0) return clipArea.y0;
+  if(y > clipArea.y1) return clipArea.y1;
   return y;
 }
 
@@ -680,28 +1799,22 @@ inline int FlexIO2VGA::clip_y(int y) {
 // draw a horizontal line pixel with clipping.
 //============================================
 FLASHMEM void FlexIO2VGA::drawHLine(int y, int x1, int x2, int color) {
-  int nx1;
-  int nx2;
-  // line out of screen ?
+  // line out of clip rectangle ?
   if(clip_y(y) != y) return;
-  nx1 = clip_x(x1);
-  nx2 = clip_x(x2);
-  if(x1 <= x2) drawHLineFast(y, nx1, nx2, color);
-  else drawHLineFast(y, nx2, nx1, color);
+  if(x1 > x2) SWAP(x1, x2);
+  if((x2 < clipArea.x0) || (x1 > clipArea.x1)) return;
+  drawHLineFast(y, clip_x(x1), clip_x(x2), color);
 }
 
 //==========================================
 // draw a vertical line pixel with clipping.
 //==========================================
 FLASHMEM void FlexIO2VGA::drawVLine(int x, int y1, int y2, int color) {
-  int ny1;
-  int ny2;
-  // line out of screen ?
+  // line out of clip rectangle ?
   if(clip_x(x) != x) return;
-  ny1 = clip_y(y1);
-  ny2 = clip_y(y2);
-  if(y1 <= y2) drawVLineFast(x, ny1, ny2, color);
-  else drawVLineFast(x, ny2, ny1, color);
+  if(y1 > y2) SWAP(y1, y2);
+  if((y2 < clipArea.y0) || (y1 > clipArea.y1)) return;
+  drawVLineFast(x, clip_y(y1), clip_y(y2), color);
 }
 
 //=====================================================
@@ -725,35 +1838,87 @@ inline void FlexIO2VGA::delta_and_sign(int v1, int v2, int *delta, int *sign) {
 // draw a line with or without its last pixel.
 //============================================
 FLASHMEM void FlexIO2VGA::drawLine(int x0, int y0, int x1, int y1, int color, bool no_last_pixel) {
+  _fb = s_frameBuffer[frameBufferIndex];
+  int ya = fb_height;
+  int yb = -1;
+  lineRows(x0, y0, x1, y1, color, no_last_pixel, &ya, &yb);
+  if(yb >= 0) setDirty(ya, yb);
+}
+
+//=====================================================
+// Draw a line into _fb, which the caller sets, and
+// widen the frame buffer rows *ya to *yb to cover it.
+// The caller marks them dirty, so a batch of lines
+// does it once.
+//=====================================================
+void FlexIO2VGA::lineRows(int x0, int y0, int x1, int y1, int color, bool no_last_pixel,
+                          int *ya, int *yb) {
   int delta_x;
   int sign_x;
   int delta_y;
   int sign_y;
-  int err;
-  int err2;
-  if(x0 == x1) {
-    if(y0 == y1) drawPixel(x0, y0, color);
-    else drawVLine(x0, y0, y1, color);
+  int32_t err;
+  uint8_t c = (bpp == 1) ? monoByte(color) : (color & 0x0f);
+  if((x0 == x1) && (y0 == y1)) {
+    if(no_last_pixel) return;
+    if((x0 < clipArea.x0) || (x0 > clipArea.x1) || (y0 < clipArea.y0) || (y0 > clipArea.y1)) return;
+    int row = fbRow(y0);
+    fbPixel(x0, row, c);
+    if(row < *ya) *ya = row;
+    if(row > *yb) *yb = row;
     return;
-  }	else if(y0 == y1) {
-    drawHLine(y0, x0, x1, color);
   }
+  // Only the pixels inside the clip rectangle are stepped
+  // through, but they are the pixels of the whole line, the
+  // error term is worked out at the first one. Straight
+  // lines go the same way, a horizontal one is one run.
   delta_and_sign(x0, x1, &delta_x, &sign_x);
   delta_and_sign(y0, y1, &delta_y, &sign_y);
-  err= delta_x - delta_y;
-  do {
-    drawPixel(x0, y0, color);
-    err2 = 2 * err;
-    if(err2 > -delta_y) {
-      err -= delta_y;
-      x0 += sign_x;
-    } else if(err2 < delta_x) {
-      err += delta_x;
-      y0 += sign_y;
+  int first, last;
+  if(!vga_line_clip(x0, y0, x1, y1, clipArea.x0, clipArea.y0, clipArea.x1, clipArea.y1, &first, &last)) return;
+  bool xMajor = delta_x >= delta_y;
+  int d = xMajor ? delta_x : delta_y;
+  int e = xMajor ? delta_y : delta_x;
+  if(no_last_pixel && (last == d)) last--;
+  if(first > last) return;
+  int mFirst = vga_line_minor(first, d, e);
+  int mLast = vga_line_minor(last, d, e);
+  int y2 = xMajor ? y0 + sign_y * mFirst : y0 + sign_y * first;
+  int y3 = xMajor ? y0 + sign_y * mLast : y0 + sign_y * last;
+  if(y2 > y3) SWAP(y2, y3);
+  if((y2 == y3) || !hw_scroll || (y3 < scroll_top) || (y2 >= (scroll_top + scroll_rows))) {
+    // Step through the frame buffer, see line.h. Shallow
+    // lines are drawn a row run at a time. A line on one
+    // row is moved to its frame buffer row.
+    int row = fbRow(y2);
+    uint8_t *fb = _fb + (row - y2) * _pitch;
+    bool runs = delta_x >= (VGA_LINE_RUN_MIN * delta_y);
+    if(bpp == 1) {
+      if(runs) vga_line_runs1(fb, _pitch, x0, y0, x1, y1, c, first, last);
+      else vga_line1(fb, _pitch, x0, y0, x1, y1, c, first, last);
+    } else {
+      if(runs) vga_line_runs4(fb, _pitch, x0, y0, x1, y1, c, first, last);
+      else vga_line4(fb, _pitch, x0, y0, x1, y1, c, first, last);
     }
-  } while( (x0 != x1) || (y0 != y1) );
-  // plot last line pixel;
-  if(!no_last_pixel) drawPixel(x1, y1, color);
+    if(row < *ya) *ya = row;
+    if((row + y3 - y2) > *yb) *yb = row + y3 - y2;
+    return;
+  }
+  // Rows inside a hardware scrolled print window are out
+  // of order, go a pixel at a time.
+  int m = mFirst;
+  err = vga_line_err(first, m, d, e);
+  for(int k = first; k <= last; k++) {
+    int row = fbRow(xMajor ? y0 + sign_y * m : y0 + sign_y * k);
+    fbPixel(xMajor ? x0 + sign_x * k : x0 + sign_x * m, row, c);
+    if(row < *ya) *ya = row;
+    if(row > *yb) *yb = row;
+    if(err > 0) {
+      m++;
+      err -= 2 * d;
+    }
+    err += 2 * e;
+  }
 }
 
 //===================================================================
@@ -762,17 +1927,11 @@ FLASHMEM void FlexIO2VGA::drawLine(int x0, int y0, int x1, int y1, int color, bo
 //===================================================================
 inline void FlexIO2VGA::drawHLineFast(int y, int x1, int x2, int color) {
   _fb = s_frameBuffer[frameBufferIndex];
-
-  while(x1 <= x2) {
-    unsigned int sel = (x1 & 1) << 2; // 4 or 0
-    uint8_t c = getByte(x1/2,y); // Get current 4 bit pixel pair. 
-    // remove old color
-    c &= (0xf0 >> sel);
-    // insert new color
-    c |= color << sel;
-    _fb[(y*_pitch)+(x1/2)] = c;
-    x1++;
-  }
+  int row = fbRow(y);
+  // Ragged ends merged in, 32 bit stores between (span.cpp).
+  if(bpp == 1) vga_fill_span1(&_fb[row*_pitch], x1, x2, monoByte(color));
+  else vga_fill_span4(&_fb[row*_pitch], x1, x2, color);
+  setDirty(row, row);
 }
 
 //=================================================================
@@ -782,14 +1941,27 @@ inline void FlexIO2VGA::drawHLineFast(int y, int x1, int x2, int color) {
 inline void FlexIO2VGA::drawVLineFast(int x, int y1, int y2, int color) {
   _fb = s_frameBuffer[frameBufferIndex];
 
+  if(bpp == 1) {
+    uint8_t bit = 1 << (x & 7);
+    uint8_t c = monoByte(color) & bit;
+    while(y1 <= y2) {
+      int row = fbRow(y1);
+      _fb[(row*_pitch)+(x/8)] = (_fb[(row*_pitch)+(x/8)] & ~bit) | c;
+      setDirty(row, row);
+      y1++;
+    }
+    return;
+  }
   while(y1 <= y2) {
     unsigned int sel = (x & 1) << 2; // 4 or 0
-    uint8_t c = getByte(x/2,y1); // Get current 4 bit pixel pair. 
+    int row = fbRow(y1);
+    uint8_t c = _fb[(row*_pitch)+(x/2)]; // Get current 4 bit pixel pair. 
     // remove old color
     c &= (0xf0 >> sel);
     // insert new color
     c |= color << sel;
-    _fb[(y1*_pitch)+(x/2)] = c;
+    _fb[(row*_pitch)+(x/2)] = c;
+    setDirty(row, row);
     y1++;
   }
 }
@@ -818,6 +1990,7 @@ FLASHMEM void FlexIO2VGA::draw_v_line(int16_t x, int16_t y, int16_t lenght, uint
 // Draw a rectangle.
 //==================
 FLASHMEM void FlexIO2VGA::drawRect(int x0, int y0, int x1, int y1, int color) {
+  if(clipOutside(min(x0, x1), min(y0, y1), max(x0, x1), max(y0, y1))) return;
   bool wasActive = false;
   if(gCursor.active) {
     gCursorOff(); // Must turn off software driven graphic cursor if on !!
@@ -834,38 +2007,16 @@ FLASHMEM void FlexIO2VGA::drawRect(int x0, int y0, int x1, int y1, int color) {
 // Draw a rectangle filled.
 //=========================
 FLASHMEM void FlexIO2VGA::fillRect(int x0, int y0, int x1, int y1, int color) {
-  int t;
-  x0 = clip_x(x0);
-  y0 = clip_y(y0);
-  x1 = clip_x(x1);
-  y1 = clip_y(y1);
+  if(!clipBox(&x0, &y0, &x1, &y1)) return;
   // increase speed if the rectangle is a single pixel, horizontal or vertical line
   if( (x0 == x1) ) {
     if(y0 == y1) {
       return drawPixel(x0, y0, color);
     } else {
-      if(y0 < y1) {
-        return drawVLineFast(x0, y0, y1, color);
-      } else {
-        return drawVLineFast(x0, y1, y0, color);
-      }
+      return drawVLineFast(x0, y0, y1, color);
     }
   } else if(y0 == y1) {
-    if(x0 < x1) {
-      return drawHLineFast(y0, x0, x1, color);
-    } else {
-      return drawHLineFast(y0, x1, x0, color);
-    }
-  }
-  if( x0 > x1 ) {
-    t = x0;
-    x0 = x1;
-    x1 = t;
-  }
-  if( y0 > y1 ) {
-    t = y0;
-    y0 = y1;
-    y1 = t;
+    return drawHLineFast(y0, x0, x1, color);
   }
   while(y0 <= y1) {
     drawHLineFast(y0, x0, x1, color);
@@ -873,6 +2024,342 @@ FLASHMEM void FlexIO2VGA::fillRect(int x0, int y0, int x1, int y1, int color) {
   }
 }
 
+//=====================================================
+// Draw n points in one color. Writes straight into the
+// frame buffer, marking the rows dirty once at the end.
+//=====================================================
+FLASHMEM void FlexIO2VGA::drawPixels(const Point2D *points, int n, uint8_t color) {
+  if(n <= 0) return;
+  bool wasActive = false;
+  if(gCursor.active) {
+    gCursorOff(); // Must turn off software driven graphic cursor if on !!
+    wasActive = true;
+  }
+  _fb = s_frameBuffer[frameBufferIndex];
+  uint8_t c = (bpp == 1) ? monoByte(color) : (color & 0x0f);
+  int ya = fb_height;
+  int yb = -1;
+  for(int i = 0; i < n; i++) {
+    int x = points[i].x;
+    int y = points[i].y;
+    if((x < clipArea.x0) || (x > clipArea.x1) || (y < clipArea.y0) || (y > clipArea.y1)) continue;
+    y = fbRow(y);
+    fbPixel(x, y, c);
+    if(y < ya) ya = y;
+    if(y > yb) yb = y;
+  }
+  if(yb >= 0) setDirty(ya, yb);
+  if(wasActive) gCursorOn();
+}
+
+//=====================================================
+// Draw n line segments, each in its own color. Draws
+// straight into the frame buffer, marking the rows
+// dirty once at the end.
+//=====================================================
+FLASHMEM void FlexIO2VGA::drawLines(const Line2D *lines, int n) {
+  if(n <= 0) return;
+  bool wasActive = false;
+  if(gCursor.active) {
+    gCursorOff(); // Must turn off software driven graphic cursor if on !!
+    wasActive = true;
+  }
+  _fb = s_frameBuffer[frameBufferIndex];
+  int ya = fb_height;
+  int yb = -1;
+  for(int i = 0; i < n; i++)
+    lineRows(lines[i].x0, lines[i].y0, lines[i].x1, lines[i].y1, lines[i].color, false, &ya, &yb);
+  if(yb >= 0) setDirty(ya, yb);
+  if(wasActive) gCursorOn();
+}
+
+//=====================================================
+// Draw lines joining n points. The shared points are
+// only drawn once.
+//=====================================================
+FLASHMEM void FlexIO2VGA::drawPolyline(const Point2D *points, int n, uint8_t color) {
+  if(n <= 0) return;
+  bool wasActive = false;
+  if(gCursor.active) {
+    gCursorOff(); // Must turn off software driven graphic cursor if on !!
+    wasActive = true;
+  }
+  _fb = s_frameBuffer[frameBufferIndex];
+  int ya = fb_height;
+  int yb = -1;
+  if(n == 1) lineRows(points[0].x, points[0].y, points[0].x, points[0].y, color, false, &ya, &yb);
+  for(int i = 0; i < (n - 1); i++)
+    lineRows(points[i].x, points[i].y, points[i+1].x, points[i+1].y, color, i < (n - 2), &ya, &yb);
+  if(yb >= 0) setDirty(ya, yb);
+  if(wasActive) gCursorOn();
+}
+
+//=====================================================
+// Fill n rectangles, each in its own color. Fills
+// straight into the frame buffer a row span at a time,
+// marking the rows dirty once at the end.
+//=====================================================
+FLASHMEM void FlexIO2VGA::fillRects(const Rect2D *rects, int n) {
+  if(n <= 0) return;
+  bool wasActive = false;
+  if(gCursor.active) {
+    gCursorOff(); // Must turn off software driven graphic cursor if on !!
+    wasActive = true;
+  }
+  _fb = s_frameBuffer[frameBufferIndex];
+  int ya = fb_height;
+  int yb = -1;
+  for(int i = 0; i < n; i++) {
+    int x0 = rects[i].x0;
+    int y0 = rects[i].y0;
+    int x1 = rects[i].x1;
+    int y1 = rects[i].y1;
+    if(!clipBox(&x0, &y0, &x1, &y1)) continue;
+    uint8_t c = (bpp == 1) ? monoByte(rects[i].color) : (rects[i].color & 0x0f);
+    for(int y = y0; y <= y1; y++) {
+      int row = fbRow(y);
+      if(bpp == 1) vga_fill_span1(&_fb[row*_pitch], x0, x1, c);
+      else vga_fill_span4(&_fb[row*_pitch], x0, x1, c);
+      if(row < ya) ya = row;
+      if(row > yb) yb = row;
+    }
+  }
+  if(yb >= 0) setDirty(ya, yb);
+  if(wasActive) gCursorOn();
+}
+
+//=====================================================
+// Test if a queued async op reads or writes anywhere
+// in start to end-1.
+//=====================================================
+static bool dmaPending(const uint8_t *start, const uint8_t *end) {
+  for(uint32_t i = dmaTail; i != dmaHead; i++) {
+    const dma_op *op = &dmaQueue[i & (DMA_OPS - 1)];
+    uint32_t span = (uint32_t)(op->rows - 1) * _pitch + op->bytes;
+    if((op->dst < end) && ((op->dst + span) > start)) return true;
+    if(op->src && (op->src < end) && ((op->src + span) > start)) return true;
+  }
+  return false;
+}
+
+//=====================================================
+// Wait for a free queue slot.
+//=====================================================
+static dma_op *dmaSlot(void) {
+  while((dmaHead - dmaTail) >= DMA_OPS) yield();
+  return &dmaQueue[dmaHead & (DMA_OPS - 1)];
+}
+
+//=====================================================
+// Queue the op filled in at dmaSlot() and start it if
+// the channel is idle. Returns its fence.
+//=====================================================
+uint32_t FlexIO2VGA::submitDma(void) {
+  const dma_op *op = &dmaQueue[dmaHead & (DMA_OPS - 1)];
+  uint32_t span = (op->rows - 1) * _pitch + op->bytes;
+  // Write back and drop the cached rows so a later
+  // eviction can't overwrite the transfer. Done here,
+  // not in startDma(), to keep it out of the section
+  // with interrupts off.
+  if(fbMem != VGA_MEM_DTCM) {
+    arm_dcache_flush_delete(op->dst, span);
+    if(op->src) arm_dcache_flush_delete((void *)op->src, span);
+  }
+  __disable_irq();
+  uint32_t fence = dmaHead + 1;
+  dmaHead = fence;
+  if(!dmaRunning) startDma();
+  __enable_irq();
+  return fence;
+}
+
+//=====================================================
+// Fill a rectangle, the whole words of each row by DMA
+// and the ragged columns either side by the CPU. Falls
+// back to fillRect() if there are no whole words or
+// hardware scroll has the rows out of order.
+// Returns the fence of the queued fill, 0 if none.
+//=====================================================
+FLASHMEM uint32_t FlexIO2VGA::queueFill(int x0, int y0, int x1, int y1, int color,
+                                        uint8_t flags, vga_job_t done, void *arg) {
+  int ppb = 8 / bpp; // Pixels per byte.
+  int size = (_pitch & 3) ? ((_pitch & 1) ? 1 : 2) : 4;
+  if(!clipBox(&x0, &y0, &x1, &y1)) {
+    if(done) done(arg);
+    return 0;
+  }
+  _fb = s_frameBuffer[frameBufferIndex];
+  uint8_t *first = &_fb[y0*_pitch];
+  uint8_t *end = &_fb[(y1+1)*_pitch];
+  // Columns b0 to b1-1 are whole transfers.
+  int b0 = (((x0 + ppb - 1) / ppb) + size - 1) & ~(size - 1);
+  int b1 = ((x1 + 1) / ppb) & ~(size - 1);
+
+  if(hw_scroll || (b1 <= b0)) {
+    // Earlier fills of these rows must land first.
+    while(dmaPending(first, end)) yield();
+    fillRect(x0, y0, x1, y1, color);
+    if(flags & DMA_OP_CURSOR) {
+      getChar(tCursorX(),tCursorY(),tCursor.char_under_cursor);
+      getGptr(gCursor.gCursor_x,gCursor.gCursor_y,gCursor.char_under_cursor);
+    }
+    if(done) done(arg);
+    return 0;
+  }
+  if((x0 < b0 * ppb) || (x1 >= b1 * ppb)) {
+    while(dmaPending(first, end)) yield();
+    if(x0 < b0 * ppb) fillRect(x0, y0, b0 * ppb - 1, y1, color);
+    if(x1 >= b1 * ppb) fillRect(b1 * ppb, y0, x1, y1, color);
+  }
+
+  dma_op *op = dmaSlot();
+  op->word = ((bpp == 1) ? monoByte(color) : (color & 0x0f) * 0x11) * 0x01010101UL;
+  op->src = NULL;
+  op->dst = first + b0;
+  op->bytes = b1 - b0;
+  op->rows = y1 - y0 + 1;
+  op->size = size;
+  op->flags = flags;
+  op->done = done;
+  op->arg = arg;
+  return submitDma();
+}
+
+//=====================================================
+// Start the op at dmaTail. Called with interrupts off
+// or from DmaInterrupt(). Its rows were flushed from
+// the cache by submitDma().
+//=====================================================
+void FlexIO2VGA::startDma(void) {
+  dma_op *op = &dmaQueue[dmaTail & (DMA_OPS - 1)];
+  uint32_t span = (op->rows - 1) * _pitch + op->bytes;
+  // A copy forwards onto itself would overwrite source not
+  // yet read, so it runs from the last transfer backwards.
+  bool back = op->src && (op->dst > op->src);
+  uint32_t start = back ? span - op->size : 0;
+  int16_t step = back ? -op->size : op->size;
+  int32_t skip = back ? (int32_t)op->bytes - (int32_t)_pitch : (int32_t)(_pitch - op->bytes);
+  dmafill.TCD->ATTR = DMA_TCD_ATTR_SSIZE(op->size >> 1) | DMA_TCD_ATTR_DSIZE(op->size >> 1);
+  // One row per minor loop, then step to the next row.
+  if(op->src) {
+    dmafill.TCD->SADDR = op->src + start;
+    dmafill.TCD->SOFF = step;
+    dmafill.TCD->NBYTES_MLOFFYES = DMA_TCD_NBYTES_SMLOE | DMA_TCD_NBYTES_DMLOE |
+                                   DMA_TCD_NBYTES_MLOFFYES_MLOFF(skip) |
+                                   DMA_TCD_NBYTES_MLOFFYES_NBYTES(op->bytes);
+  } else {
+    dmafill.TCD->SADDR = &op->word;
+    dmafill.TCD->SOFF = 0;
+    dmafill.TCD->NBYTES_MLOFFYES = DMA_TCD_NBYTES_DMLOE |
+                                   DMA_TCD_NBYTES_MLOFFYES_MLOFF(skip) |
+                                   DMA_TCD_NBYTES_MLOFFYES_NBYTES(op->bytes);
+  }
+  dmafill.TCD->SLAST = 0;
+  dmafill.TCD->DADDR = op->dst + start;
+  dmafill.TCD->DOFF = step;
+  dmafill.TCD->CITER_ELINKNO = op->rows;
+  dmafill.TCD->BITER_ELINKNO = op->rows;
+  dmafill.TCD->DLASTSGA = 0;
+  dmafill.TCD->CSR = DMA_TCD_CSR_INTMAJOR | DMA_TCD_CSR_DREQ;
+  dmaRunning = true;
+  dmafill.enable();
+}
+
+//=====================================================
+// Async op done. Start the next one, then tell the
+// caller.
+//=====================================================
+void FlexIO2VGA::DmaInterrupt(void) {
+  dmafill.clearInterrupt();
+  if(!dmaRunning) return;
+  dma_op *op = &dmaQueue[dmaTail & (DMA_OPS - 1)];
+  uint8_t flags = op->flags;
+  vga_job_t done = op->done;
+  void *arg = op->arg;
+  dmaTail = dmaTail + 1;
+  if(dmaTail != dmaHead) startDma();
+  else dmaRunning = false;
+  if(flags & DMA_OP_CURSOR) {
+    getChar(tCursorX(),tCursorY(),tCursor.char_under_cursor);
+    getGptr(gCursor.gCursor_x,gCursor.gCursor_y,gCursor.char_under_cursor);
+  }
+  if(done) done(arg);
+}
+
+//==================================
+// Fill a rectangle asynchronously.
+//==================================
+FLASHMEM uint32_t FlexIO2VGA::fillRectAsync(int x0, int y0, int x1, int y1, int color,
+                                            vga_job_t done, void *arg) {
+  return queueFill(x0, y0, x1, y1, color, 0, done, arg);
+}
+
+//====================================
+// Clear full screen asynchronously.
+//====================================
+FLASHMEM uint32_t FlexIO2VGA::clearAsync(uint8_t color, vga_job_t done, void *arg) {
+  // Not clipped, same as clear().
+  clip_rect saved = clipScreen();
+  uint32_t fence = queueFill(0, 0, fb_width - 1, fb_height - 1, color, DMA_OP_CURSOR, done, arg);
+  clipArea = saved;
+  return fence;
+}
+
+//==============================================
+// Clear the print window asynchronously. The
+// text cursor goes home at once.
+//==============================================
+FLASHMEM uint32_t FlexIO2VGA::clearPrintWindowAsync(vga_job_t done, void *arg) {
+  int x0, y0, x1, y1;
+  printWindowRect(&x0, &y0, &x1, &y1);
+  cursor_x = 0;
+  cursor_y = 0;
+  return queueFill(x0, y0, x1, y1, background_color, DMA_OP_CURSOR, done, arg);
+}
+
+//=====================================================
+// Test if the async fill with this fence is done.
+//=====================================================
+bool FlexIO2VGA::fenceDone(uint32_t fence) {
+  if(fence == 0) return true;
+  return (int32_t)(dmaTail - fence) >= 0;
+}
+
+//=====================================================
+// Wait until the async fill with this fence is done.
+//=====================================================
+void FlexIO2VGA::waitFence(uint32_t fence) {
+  while(!fenceDone(fence)) yield();
+}
+
+bool FlexIO2VGA::dmaBusy(void) { return dmaTail != dmaHead; }
+
+//=====================================================
+// Wait until all async fills are done.
+//=====================================================
+void FlexIO2VGA::waitDma(void) {
+  while(dmaTail != dmaHead) yield();
+}
+
+//======================================================================
+//  Corners of a Rectangle at a given Angle, clockwise from the
+//  bottom right one before it is turned.
+//======================================================================
+static void quadCorners(int16_t centerx, int16_t centery, int16_t w, int16_t h, int16_t angle,
+                        int32_t *px, int32_t *py) {
+	vga_affine_t m, half;
+	// Corners are at +-w/2, +-h/2. Halve in the transform so
+	// odd sizes stay centered.
+	vga_affine_rotate(&m, vga_deg(angle));
+	vga_affine_scale(&half, VGA_Q16_ONE / 2, VGA_Q16_ONE / 2);
+	vga_affine_mul(&m, &m, &half);
+	vga_affine_translate(&m, centerx, centery);
+	vga_affine_apply(&m,  w,  h, &px[0], &py[0]);
+	vga_affine_apply(&m, -w,  h, &px[1], &py[1]);
+	vga_affine_apply(&m, -w, -h, &px[2], &py[2]);
+	vga_affine_apply(&m,  w, -h, &px[3], &py[3]);
+}
+
 //======================================================================
 //  Displays a Rectangle at a given Angle.
 //  centerx			: specifies the center of the Rectangle.
@@ -882,29 +2369,9 @@ FLASHMEM void FlexIO2VGA::fillRect(int x0, int y0, int x1, int y1, int color) {
 //  color	    	: specifies the Color to use for Fill the Rectangle.
 //======================================================================
 FLASHMEM void FlexIO2VGA::drawQuad(int16_t centerx, int16_t centery, int16_t w, int16_t h, int16_t angle, uint8_t color){
-	int16_t	px[4],py[4];
-	float	l;
-	float	raddeg = 3.14159 / 180;
-	float	w2 = w / 2.0;
-	float	h2 = h / 2.0;
-	float	vec = (w2*w2)+(h2*h2);
-	float	w2l;
-	float	pangle[4];
-
-	l = sqrtf(vec);
-	w2l = w2 / l;
-	pangle[0] = acosf(w2l) / raddeg;
-	pangle[1] = 180.0 - (acosf(w2l) / raddeg);
-	pangle[2] = 180.0 + (acosf(w2l) / raddeg);
-	pangle[3] = 360.0 - (acosf(w2l) / raddeg);
-	px[0] = (int16_t)(calcco[((int16_t)(pangle[0]) + angle) % 360] * l + centerx);
-	py[0] = (int16_t)(calcsi[((int16_t)(pangle[0]) + angle) % 360] * l + centery);
-	px[1] = (int16_t)(calcco[((int16_t)(pangle[1]) + angle) % 360] * l + centerx);
-	py[1] = (int16_t)(calcsi[((int16_t)(pangle[1]) + angle) % 360] * l + centery);
-	px[2] = (int16_t)(calcco[((int16_t)(pangle[2]) + angle) % 360] * l + centerx);
-	py[2] = (int16_t)(calcsi[((int16_t)(pangle[2]) + angle) % 360] * l + centery);
-	px[3] = (int16_t)(calcco[((int16_t)(pangle[3]) + angle) % 360] * l + centerx);
-	py[3] = (int16_t)(calcsi[((int16_t)(pangle[3]) + angle) % 360] * l + centery);
+	int32_t	px[4],py[4];
+
+	quadCorners(centerx, centery, w, h, angle, px, py);
 	// here we draw the quad
 	drawLine(px[0],py[0],px[1],py[1],color, false);
 	drawLine(px[1],py[1],px[2],py[2],color, false);
@@ -921,38 +2388,53 @@ FLASHMEM void FlexIO2VGA::drawQuad(int16_t centerx, int16_t centery, int16_t w,
 //  fillcolor    	: specifies the Color to use for Fill the Rectangle.
 //======================================================================
 FLASHMEM void FlexIO2VGA::fillQuad(int16_t centerx, int16_t centery, int16_t w, int16_t h, int16_t angle, uint8_t fillcolor){
-	int16_t	px[4],py[4];
-	float	l;
-	float	raddeg = 3.14159 / 180;
-	float	w2 = w / 2.0;
-	float	h2 = h / 2.0;
-	float	vec = (w2*w2)+(h2*h2);
-	float	w2l;
-	float	pangle[4];
-
-	l = sqrtf(vec);
-	w2l = w2 / l;
-	pangle[0] = acosf(w2l) / raddeg;
-	pangle[1] = 180.0 - (acosf(w2l) / raddeg);
-	pangle[2] = 180.0 + (acosf(w2l) / raddeg);
-	pangle[3] = 360.0 - (acosf(w2l) / raddeg);
-	px[0] = (int16_t)(calcco[((int16_t)(pangle[0]) + angle) % 360] * l + centerx);
-	py[0] = (int16_t)(calcsi[((int16_t)(pangle[0]) + angle) % 360] * l + centery);
-	px[1] = (int16_t)(calcco[((int16_t)(pangle[1]) + angle) % 360] * l + centerx);
-	py[1] = (int16_t)(calcsi[((int16_t)(pangle[1]) + angle) % 360] * l + centery);
-	px[2] = (int16_t)(calcco[((int16_t)(pangle[2]) + angle) % 360] * l + centerx);
-	py[2] = (int16_t)(calcsi[((int16_t)(pangle[2]) + angle) % 360] * l + centery);
-	px[3] = (int16_t)(calcco[((int16_t)(pangle[3]) + angle) % 360] * l + centerx);
-	py[3] = (int16_t)(calcsi[((int16_t)(pangle[3]) + angle) % 360] * l + centery);
+	int32_t	px[4],py[4];
+
+	quadCorners(centerx, centery, w, h, angle, px, py);
 	// We draw 2 filled triangle for made the quad
 	// To be uniform we have to use only the Fillcolor
 	fillTriangle(px[0],py[0],px[1],py[1],px[2],py[2],fillcolor);
 	fillTriangle(px[2],py[2],px[3],py[3],px[0],py[0],fillcolor);
-	// here we draw the BorderColor from the quad
-//	drawLine(px[0],py[0],px[1],py[1],bordercolor);
-//	drawLine(px[1],py[1],px[2],py[2],bordercolor);
-//	drawLine(px[2],py[2],px[3],py[3],bordercolor);
-//	drawLine(px[3],py[3],px[0],py[0],bordercolor);
+}
+
+//=====================================================
+// Change pixels x0 to x1 of a 4 bit row a word (8
+// pixels) at a time, color a to b, or a and b swapped.
+//=====================================================
+static void recolor_row(uint8_t *row, int x0, int x1, uint8_t a, uint8_t b, bool swap) {
+  for(int p = x0 & ~7; p <= x1; p += 8) {
+    uint8_t *q = row + (p >> 1);
+    uint32_t w;
+    memcpy(&w, q, 4);
+    uint32_t n = swap ? vga_nib_swap(w, a, b) : vga_nib_subst(w, a, b);
+    int first = (p < x0) ? x0 - p : 0;
+    int last = ((p + 7) > x1) ? x1 - p : 7;
+    w = vga_nib_merge(w, n, vga_nib_range(first, last));
+    memcpy(q, &w, 4);
+  }
+}
+
+//=====================================================
+// Change color a to b (swap = false) or exchange a and
+// b (swap = true) in a rectangle.
+//=====================================================
+FLASHMEM void FlexIO2VGA::recolorRect(int x0, int y0, int x1, int y1, uint8_t a, uint8_t b, bool swap) {
+  if(!clipBox(&x0, &y0, &x1, &y1)) return;
+  _fb = s_frameBuffer[frameBufferIndex];
+  for(int y = y0; y <= y1; y++) {
+    if(bpp == 1) {
+      // Only set and clear pixels, go by color.
+      for(int x = x0; x <= x1; x++) {
+        int c = getPixel(x, y);
+        if(c == a) drawPixel(x, y, b);
+        else if(swap && (c == b)) drawPixel(x, y, a);
+      }
+      continue;
+    }
+    int row = fbRow(y);
+    recolor_row(&_fb[row*_pitch], x0, x1, a, b, swap);
+    setDirty(row, row);
+  }
 }
 
 //===========================================================
@@ -968,115 +2450,466 @@ void FlexIO2VGA::drawBitmap(int16_t x_pos, int16_t y_pos, uint8_t *bitmap, int16
   int off_x, off_y;
   uint8_t *bitmap_ptr;
   
-  fx = clip_x(x_pos);
-  // X position outside of image (right of image)
-  if(fx < x_pos) return;
+  // Bitmap outside of the clip rectangle ?
+  if(clipOutside(x_pos, y_pos, x_pos + bitmap_width - 1, y_pos + bitmap_height - 1)) return;
   // compute the number of pixels to skip at the beginning of each bitmap line and the number of pixel per line to copy
-  if(fx > x_pos) {
-    bx = fx - x_pos;
-    fw = bitmap_width - bx;
-    // X position outside of image (right of image)
-    if(fw <= 0) return;
-  } else {
-    bx = 0;
-    if( (fx + bitmap_width) >= fb_width) {
-      fw = fb_width - fx;
-    } else {
-      fw = bitmap_width;
+  fx = clip_x(x_pos);
+  bx = fx - x_pos;
+  fw = bitmap_width - bx;
+  if((fx + fw) > (clipArea.x1 + 1)) fw = clipArea.x1 + 1 - fx;
+  // compute the number of lines to skip at the beginning of bitmap and the number of lines to copy
+  fy = clip_y(y_pos);
+  by = fy - y_pos;
+  fh = bitmap_height - by;
+  if((fy + fh) > (clipArea.y1 + 1)) fh = clipArea.y1 + 1 - fy;
+
+  // (fx,fy) is the destination position in the image
+  // (bx,by) is the position in the bitmap
+  // (fw,fh) is the size to copy
+  // If a 0 value is found in the bitmap then it is substituted with the
+  // currently addressed pixel in the frame buffer.
+  if(bpp == 4) {
+    // 8 pixels at a time, 0 is the color key (see nibble.h).
+    _fb = s_frameBuffer[frameBufferIndex];
+    for(off_y = 0; off_y < fh; off_y++) {
+      int row = fbRow(fy + off_y);
+      bitmap_ptr = bitmap + (by + off_y) * bitmap_width + bx;
+      for(int p = fx & ~7; p < (fx + fw); p += 8) {
+        uint32_t src = 0;
+        for(int i = 0; i < 8; i++) {
+          off_x = p + i - fx;
+          if((off_x >= 0) && (off_x < fw)) src |= (uint32_t)(bitmap_ptr[off_x] & 0x0f) << (i * 4);
+        }
+        int first = (p < fx) ? fx - p : 0;
+        int last = ((p + 7) >= (fx + fw)) ? fx + fw - 1 - p : 7;
+        uint8_t *q = &_fb[row*_pitch + (p >> 1)];
+        uint32_t w;
+        memcpy(&w, q, 4);
+        w = vga_nib_merge(w, src, vga_nib_nonzero(src) & vga_nib_range(first, last));
+        memcpy(q, &w, 4);
+      }
+      setDirty(row, row);
+    }
+    return;
+  }
+  for(off_y = 0; off_y < fh; off_y++) {
+    bitmap_ptr = bitmap + (by + off_y) * bitmap_width + bx;
+    for(off_x = 0; off_x < fw; off_x++) {
+      // bitmap format must be the same as modeline.img_color_mode (4 bit RGBI)
+      // 0 is transparent, the pixel is left as it is.
+      if(*bitmap_ptr != 0x00) drawPixel(fx + off_x, fy + off_y, *bitmap_ptr);
+      bitmap_ptr++;
     }
   }
+}
+
+//===========================================================
+// Draw a packed bitmap, a row at a time. 4 bit rows go 8
+// pixels at a time (see vga_packed_row4()), 1 bit rows a
+// pixel at a time.
+//===========================================================
+void FlexIO2VGA::drawPacked(int16_t x_pos, int16_t y_pos, const vga_packed_t *bm) {
+  int fx, fy, fw, fh, bx, by;
+
+  if((bm->w <= 0) || (bm->h <= 0)) return;
+  if(clipOutside(x_pos, y_pos, x_pos + bm->w - 1, y_pos + bm->h - 1)) return;
+  // Clipped destination (fx,fy), size (fw,fh), and the first
+  // bitmap pixel drawn (bx,by), the same as drawBitmap().
+  fx = clip_x(x_pos);
+  bx = fx - x_pos;
+  fw = bm->w - bx;
+  if((fx + fw) > (clipArea.x1 + 1)) fw = clipArea.x1 + 1 - fx;
   fy = clip_y(y_pos);
-  // Y position outside of image (bottom of image)
-  if(fy < y_pos) return;
-  // compute the number of lines to skip at the beginning of bitmap and the number of lines to copy
-  if(fy > y_pos) {
-    by = fy - y_pos;
-    fh = bitmap_height - by;
-    // Y position outside of image (right of image)
-    if(fh <= 0) return;
+  by = fy - y_pos;
+  fh = bm->h - by;
+  if((fy + fh) > (clipArea.y1 + 1)) fh = clipArea.y1 + 1 - fy;
+
+  _fb = s_frameBuffer[frameBufferIndex];
+  for(int off_y = 0; off_y < fh; off_y++) {
+    int row = fbRow(fy + off_y);
+    uint8_t *dst = &_fb[row*_pitch];
+    if(bpp == 4) {
+      vga_packed_row4(dst, fx, bm, by + off_y, bx, fw);
+    } else {
+      const uint8_t *pix = bm->pixels + (by + off_y) * bm->pitch;
+      const uint8_t *mask = bm->mask ? bm->mask + (by + off_y) * bm->maskPitch : NULL;
+      for(int off_x = 0; off_x < fw; off_x++) {
+        int sx = bx + off_x;
+        int x = fx + off_x;
+        if(mask && !(mask[sx >> 3] & (1 << (sx & 7)))) continue;
+        uint8_t bit = 1 << (x & 7);
+        uint8_t c = (pix[sx >> 1] >> ((sx & 1) << 2)) & 0x0f;
+        dst[x >> 3] = (dst[x >> 3] & ~bit) | (monoByte(c) & bit);
+      }
+    }
+    setDirty(row, row);
+  }
+}
+
+//===========================================================
+// Draw a run length encoded sprite. Rows outside the clip
+// rectangle are not looked at, the rest are clipped run by
+// run (see vga_rle_row4()).
+//===========================================================
+void FlexIO2VGA::drawRle(int16_t x_pos, int16_t y_pos, const vga_rle_t *s) {
+  if((s->w <= 0) || (s->h <= 0)) return;
+  if(clipOutside(x_pos, y_pos, x_pos + s->w - 1, y_pos + s->h - 1)) return;
+  int y0 = clip_y(y_pos);
+  int y1 = clip_y(y_pos + s->h - 1);
+  _fb = s_frameBuffer[frameBufferIndex];
+  for(int y = y0; y <= y1; y++) {
+    int row = fbRow(y);
+    const uint8_t *runs = s->data + s->rows[y - y_pos];
+    if(bpp == 4) vga_rle_row4(&_fb[row*_pitch], runs, x_pos, clipArea.x0, clipArea.x1);
+    else vga_rle_row1(&_fb[row*_pitch], runs, x_pos, clipArea.x0, clipArea.x1, mono_bg);
+    setDirty(row, row);
+  }
+}
+
+//===========================================================
+// Write a row of pixels, clipped. 4 bit rows are written
+// a byte (2 pixels) at a time between the ends.
+//===========================================================
+void FlexIO2VGA::writePixels(int16_t x, int16_t y, const uint8_t *pixels, int16_t w) {
+  if((w <= 0) || clipOutside(x, y, x + w - 1, y)) return;
+  int x0 = clip_x(x);
+  int x1 = clip_x(x + w - 1);
+  const uint8_t *p = pixels + (x0 - x);
+  int row = fbRow(y);
+  _fb = s_frameBuffer[frameBufferIndex];
+  uint8_t *dst = &_fb[row*_pitch];
+  if(bpp == 4) {
+    int i = x0;
+    if(i & 1) {
+      dst[i >> 1] = (dst[i >> 1] & 0x0f) | (*p++ << 4);
+      i++;
+    }
+    for(; i < x1; i += 2, p += 2) dst[i >> 1] = (p[0] & 0x0f) | (p[1] << 4);
+    if(i == x1) dst[i >> 1] = (dst[i >> 1] & 0xf0) | (*p & 0x0f);
   } else {
-    by = 0;
-    if( (fy + bitmap_height) >= fb_height) {
-      fh = fb_height - fy;
+    for(int i = x0; i <= x1; i++) {
+      uint8_t bit = 1 << (i & 7);
+      dst[i >> 3] = (dst[i >> 3] & ~bit) | (monoByte(*p++) & bit);
+    }
+  }
+  setDirty(row, row);
+}
+
+// Where drawImage() puts the rows.
+typedef struct {
+  FlexIO2VGA *vga;
+  int16_t x;
+  int16_t y;
+} image_at;
+
+static void imageRow(void *ctx, int y, const uint8_t *pixels, int w) {
+  image_at *at = (image_at *)ctx;
+  at->vga->writePixels(at->x, at->y + y, pixels, w);
+}
+
+//===========================================================
+// Decode an image straight into the frame buffer.
+//===========================================================
+int FlexIO2VGA::drawImage(int16_t x_pos, int16_t y_pos, vga_img_t *img) {
+  image_at at = {this, x_pos, y_pos};
+  return vga_img_rows(img, imageRow, &at);
+}
+
+//=====================================================
+// Half widths of a disc, row by row from the center
+// out. x is the widest with x*x + y*y <= r*r + r (the
+// midpoint test), -1 once y is past r. err is
+// r*r + r - x*x - y*y.
+//=====================================================
+typedef struct {
+  int x;
+  int y;
+  int32_t err;
+} disc_rows;
+
+static inline void discStart(disc_rows *d, int r) {
+  d->x = r;
+  d->y = 0;
+  d->err = r;
+  if(r < 0) d->x = -1;
+}
+
+static inline int discNext(disc_rows *d) {
+  d->err -= 2 * d->y + 1;
+  d->y++;
+  while((d->err < 0) && (d->x >= 0)) {
+    d->err += 2 * d->x - 1;
+    d->x--;
+  }
+  return d->x;
+}
+
+//=====================================================
+// Draw the pixels of a circle row with
+// inner < |x - cx| <= outer. One span if inner < 0.
+//=====================================================
+inline void FlexIO2VGA::ringRow(int y, int cx, int outer, int inner, uint8_t color) {
+  if(outer < 0) return;
+  if(inner < 0) {
+    drawHLine(y, cx - outer, cx + outer, color);
+  } else if(inner < outer) {
+    drawHLine(y, cx - outer, cx - inner - 1, color);
+    drawHLine(y, cx + inner + 1, cx + outer, color);
+  }
+}
+
+//=====================================================
+// Draw a one pixel wide circle. Each row has the run
+// from the next row's half width out to its own.
+//=====================================================
+FLASHMEM void FlexIO2VGA::drawCircleOutline(int cx, int cy, int r, uint8_t color) {
+  if((r < 0) || clipOutside(cx - r, cy - r, cx + r, cy + r)) return;
+  bool wasActive = false;
+  if(gCursor.active) {
+    gCursorOff(); // Must turn of software driven graphic cursor if on !!
+    wasActive = true;
+  }
+  disc_rows d;
+  discStart(&d, r);
+  int outer = d.x;
+  for(int dy = 0; dy <= r; dy++) {
+    int next = discNext(&d);
+    int inner = min(next, outer - 1);
+    ringRow(cy + dy, cx, outer, inner, color);
+    if(dy != 0) ringRow(cy - dy, cx, outer, inner, color);
+    outer = next;
+  }
+  if(wasActive) gCursorOn();
+}
+
+//=====================================================
+// Draw a ring from radius r0 out to radius r1.
+//=====================================================
+FLASHMEM void FlexIO2VGA::drawRing(int cx, int cy, int r0, int r1, uint8_t color) {
+  if(r0 > r1) SWAP(r0, r1);
+  if((r1 < 0) || clipOutside(cx - r1, cy - r1, cx + r1, cy + r1)) return;
+  bool wasActive = false;
+  if(gCursor.active) {
+    gCursorOff(); // Must turn of software driven graphic cursor if on !!
+    wasActive = true;
+  }
+  // Pixels inside the disc of r1 but not the disc of r0 - 1.
+  disc_rows outer, inner;
+  discStart(&outer, r1);
+  discStart(&inner, r0 - 1);
+  for(int dy = 0; dy <= r1; dy++) {
+    ringRow(cy + dy, cx, outer.x, inner.x, color);
+    if(dy != 0) ringRow(cy - dy, cx, outer.x, inner.x, color);
+    discNext(&outer);
+    discNext(&inner);
+  }
+  if(wasActive) gCursorOn();
+}
+
+//=====================================================
+// Fill a disc, one span per row.
+//=====================================================
+FLASHMEM void FlexIO2VGA::fillDisc(int cx, int cy, int r, uint8_t color) {
+  if((r < 0) || clipOutside(cx - r, cy - r, cx + r, cy + r)) return;
+  bool wasActive = false;
+  if(gCursor.active) {
+    gCursorOff(); // Must turn of software driven graphic cursor if on !!
+    wasActive = true;
+  }
+  disc_rows d;
+  discStart(&d, r);
+  for(int dy = 0; dy <= r; dy++) {
+    drawHLine(cy + dy, cx - d.x, cx + d.x, color);
+    if(dy != 0) drawHLine(cy - dy, cx - d.x, cx + d.x, color);
+    discNext(&d);
+  }
+  if(wasActive) gCursorOn();
+}
+
+//==================
+// Draw a circle.
+// Pixels between radius - thickness and radius +
+// thickness, an outline if thickness is under 1/2.
+//==================
+FLASHMEM void FlexIO2VGA::drawCircle(float x, float y, float radius, float thickness, uint8_t color) {
+  int cx = lroundf(x);
+  int cy = lroundf(y);
+  if(thickness < 0.5) drawCircleOutline(cx, cy, lroundf(radius), color);
+  else drawRing(cx, cy, lroundf(radius - thickness), lroundf(radius + thickness), color);
+}
+
+//======================
+// Draw a circle filled.
+//======================
+FLASHMEM void FlexIO2VGA::fillCircle(float xm, float ym, float r, uint8_t color) {
+  fillDisc(lroundf(xm), lroundf(ym), lroundf(r), color);
+}
+
+//=====================================================
+// Circle sector, counterclockwise from direction s to
+// direction e (Q15 unit vectors, y up). Point p is
+// inside if s x p >= 0 and p x e >= 0, or if either
+// is for sectors wider than 180 degrees.
+//=====================================================
+#define ARC_BIG 0x3fffffff
+typedef struct {
+  int32_t sx, sy;
+  int32_t ex, ey;
+  bool wide;  // Over 180 degrees.
+  bool full;  // Whole circle.
+} arc_sector;
+
+static void sectorStart(arc_sector *a, int startAngle, int endAngle) {
+  int a0 = min(startAngle, endAngle);
+  int a1 = max(startAngle, endAngle);
+  a->full = (a1 - a0) >= 360;
+  a->wide = (a1 - a0) > 180;
+  a->sx = vga_cos(vga_deg(a0));
+  a->sy = vga_sin(vga_deg(a0));
+  a->ex = vga_cos(vga_deg(a1));
+  a->ey = vga_sin(vga_deg(a1));
+}
+
+// n / d rounded down, d > 0.
+static inline int32_t floorDiv(int64_t n, int64_t d) {
+  return (n >= 0) ? n / d : -((-n + d - 1) / d);
+}
+
+//=====================================================
+// x range of row py where u x p = ux*py - uy*px >= 0.
+// Returns false if there is none.
+//=====================================================
+static bool halfRow(int32_t ux, int32_t uy, int py, int *lo, int *hi) {
+  int64_t k = (int64_t)ux * py;
+  *lo = -ARC_BIG;
+  *hi = ARC_BIG;
+  if(uy > 0) *hi = floorDiv(k, uy);        // px <= k / uy
+  else if(uy < 0) *lo = -floorDiv(k, -uy); // px >= k / uy
+  else return k >= 0;
+  return true;
+}
+
+//=====================================================
+// x ranges of row py inside a sector. Returns how many
+// (0 to 2).
+//=====================================================
+static int sectorRow(const arc_sector *a, int py, int *lo, int *hi) {
+  if(a->full) {
+    lo[0] = -ARC_BIG;
+    hi[0] = ARC_BIG;
+    return 1;
+  }
+  int alo, ahi, blo, bhi;
+  bool ha = halfRow(a->sx, a->sy, py, &alo, &ahi);
+  bool hb = halfRow(-a->ex, -a->ey, py, &blo, &bhi); // p x e = -e x p
+  if(!a->wide) {
+    lo[0] = max(alo, blo);
+    hi[0] = min(ahi, bhi);
+    return (ha && hb && (lo[0] <= hi[0])) ? 1 : 0;
+  }
+  int n = 0;
+  if(ha) {
+    lo[n] = alo;
+    hi[n++] = ahi;
+  }
+  if(hb) {
+    if(n && (blo <= (hi[0] + 1)) && (bhi >= (lo[0] - 1))) {
+      // Overlapping, merge.
+      lo[0] = min(lo[0], blo);
+      hi[0] = max(hi[0], bhi);
     } else {
-      fh = bitmap_height;
+      lo[n] = blo;
+      hi[n++] = bhi;
     }
   }
+  return n;
+}
 
-  // (fx,fy) is the destination position in the image
-  // (bx,by) is the position in the bitmap
-  // (fw,fh) is the size to copy
-  // If a 0 value is found in the bitmap then it is substituted with the
-  // currently addressed pixel in the frame buffer.
-  for(off_y = 0; off_y < fh; off_y++) {
-    bitmap_ptr = bitmap + (by + off_y) * bitmap_width + bx;
-    for(off_x = 0; off_x < fw; off_x++) {
-      if(*bitmap_ptr != 0x00) {
-        // bitmap format must be the same as modeline.img_color_mode (4 bit RGBI)
-        drawPixel(fx + off_x, fy + off_y, *bitmap_ptr++);
-      } else{
-        // bitmap format must be the same as modeline.img_color_mode (4 bit RGBI)
-        drawPixel(fx + off_x, fy + off_y, getPixel(fx + off_x, fy + off_y));
-        bitmap_ptr++;
-      }
+//=====================================================
+// Draw the parts of a circle row (see ringRow()) that
+// are inside the sector ranges lo[i] to hi[i].
+//=====================================================
+inline void FlexIO2VGA::arcRow(int y, int cx, int outer, int inner, int n, const int *lo,
+                               const int *hi, uint8_t color) {
+  int rlo[2], rhi[2];
+  int nr = 0;
+  if(outer < 0) return;
+  if(inner < 0) {
+    rlo[nr] = -outer;
+    rhi[nr++] = outer;
+  } else if(inner < outer) {
+    rlo[nr] = -outer;
+    rhi[nr++] = -inner - 1;
+    rlo[nr] = inner + 1;
+    rhi[nr++] = outer;
+  }
+  for(int i = 0; i < nr; i++) {
+    for(int j = 0; j < n; j++) {
+      int a = max(rlo[i], lo[j]);
+      int b = min(rhi[i], hi[j]);
+      if(a <= b) drawHLine(y, cx + a, cx + b, color);
     }
   }
 }
 
-//==================
-// Draw a circle.
-//==================
-FLASHMEM void FlexIO2VGA::drawCircle(float x, float y, float radius, float thickness, uint8_t color) {
-  int16_t xi, yi;
-  float sq_radius = radius + thickness;
-
+//=====================================================
+// Draw a ring from radius r0 to r1 (or an outline of
+// radius r1) clipped to a sector, span by span.
+//=====================================================
+FLASHMEM void FlexIO2VGA::drawSector(int cx, int cy, int r0, int r1, int startAngle, int endAngle,
+                                     bool outline, uint8_t color) {
+  if(r0 > r1) SWAP(r0, r1);
+  if((r1 < 0) || clipOutside(cx - r1, cy - r1, cx + r1, cy + r1)) return;
   bool wasActive = false;
   if(gCursor.active) {
     gCursorOff(); // Must turn of software driven graphic cursor if on !!
     wasActive = true;
   }
-
-  for (xi = -sq_radius; xi < sq_radius; xi++) {
-    uint8_t found_state = 0;
-    for (yi = -sq_radius; yi < sq_radius; yi++) {
-      const float r = sqrtf(xi * xi + yi * yi);
-      if(fabs(r - radius) <= thickness) {
-        if(found_state == 0) found_state = 1;
-        if(found_state == 2) found_state = 3;
-          vga4bit.drawPixel(x + xi, y + yi, color);
-      } else if(found_state == 1) {
-        yi = -yi;
-        found_state = 2;
-      } else if(found_state == 3) {
-        break;
-      }
+  arc_sector sec;
+  sectorStart(&sec, startAngle, endAngle);
+  disc_rows o, in;
+  discStart(&o, r1);
+  discStart(&in, r0 - 1);
+  int outer = o.x;
+  int lo[2], hi[2];
+  for(int dy = 0; dy <= r1; dy++) {
+    int next = discNext(&o);
+    int inner = outline ? min(next, outer - 1) : in.x;
+    // Screen rows go down, sector y goes up.
+    int n = sectorRow(&sec, -dy, lo, hi);
+    arcRow(cy + dy, cx, outer, inner, n, lo, hi, color);
+    if(dy != 0) {
+      n = sectorRow(&sec, dy, lo, hi);
+      arcRow(cy - dy, cx, outer, inner, n, lo, hi, color);
     }
+    discNext(&in);
+    outer = next;
   }
   if(wasActive) gCursorOn();
 }
 
-//======================
-// Draw a circle filled.
-//======================
-FLASHMEM void FlexIO2VGA::fillCircle(float xm, float ym, float r, uint8_t color) {
-  drawCircle(xm, ym, r, r, color);
-/*
-  for(y = -r; y <= r; y++) {
-    for(x = -r; x <= r; x++) {
-      if((x * x) + (y * y) <= (r * r)) {
-        drawHLine(ym + y, xm + x, xm - x, color);
-        if(y != 0) drawHLine(ym - y, xm + x, xm - x, color);
-        break;
-      }
-    }
-  }
-*/
+//=====================================================
+// Draw an arc thickness pixels wide, inward from r.
+//=====================================================
+FLASHMEM void FlexIO2VGA::drawArc(int cx, int cy, int r, int startAngle, int endAngle,
+                                  int thickness, uint8_t color) {
+  if(thickness <= 1) drawSector(cx, cy, r, r, startAngle, endAngle, true, color);
+  else drawSector(cx, cy, r - thickness + 1, r, startAngle, endAngle, false, color);
+}
+
+//=====================================================
+// Fill a pie slice.
+//=====================================================
+FLASHMEM void FlexIO2VGA::fillArc(int cx, int cy, int r, int startAngle, int endAngle, uint8_t color) {
+  drawSector(cx, cy, 0, r, startAngle, endAngle, false, color);
 }
 
 //=================
 // draw a triangle
 //=================
 FLASHMEM void FlexIO2VGA::drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2, int color) {
+  if(clipOutside(min(x0, min(x1, x2)), min(y0, min(y1, y2)),
+                 max(x0, max(x1, x2)), max(y0, max(y1, y2)))) return;
   bool wasActive = false;
   if(gCursor.active) {
     gCursorOff(); // Must turn of software driven graphic cursor if on !!
@@ -1100,6 +2933,8 @@ FLASHMEM void FlexIO2VGA::fillTriangle(int x1, int y1, int x2, int y2, int x3, i
   int signx1, signx2, dx1, dy1, dx2, dy2;
   int e1, e2;
 
+  if(clipOutside(min(x1, min(x2, x3)), min(y1, min(y2, y3)),
+                 max(x1, max(x2, x3)), max(y1, max(y2, y3)))) return;
   bool wasActive = false;
   if(gCursor.active) {
     gCursorOff(); // Must turn of software driven graphic cursor if on !!
@@ -1285,16 +3120,23 @@ next4:
 FLASHMEM void FlexIO2VGA::drawArc(int xcenter, int ycenter,
                                   int xradius, int yradius,
                                   int startAngle, int endAngle) {
-  float ang = (((startAngle<=endAngle) ? startAngle : endAngle) * (PI/180));
-  float range = (((endAngle>startAngle) ? endAngle : startAngle) * (PI/180));
-  float x = (xradius * cos(ang));
-  float y = (yradius * sin(ang));
-  do {
-    vga4bit.drawPixel((int)(xcenter+x+0.5),(int)(ycenter-y+0.5),15);
-    ang += 0.001;
-    x = (xradius * cos(ang));
-    y = (yradius * sin(ang));
-  } while(ang <= range);
+  if(clipOutside(xcenter - abs(xradius), ycenter - abs(yradius),
+                 xcenter + abs(xradius), ycenter + abs(yradius))) return;
+  int lo = (startAngle <= endAngle) ? startAngle : endAngle;
+  int hi = (endAngle > startAngle) ? endAngle : startAngle;
+  vga_angle_t a0 = vga_deg(lo);
+  uint32_t span = (uint32_t)(((int64_t)(hi - lo) * VGA_ANGLE_TURN) / 360);
+  // About a pixel per step, 65536 / (2 * pi * r).
+  int r = max(max(abs(xradius), abs(yradius)), 1);
+  uint32_t step = max(10430 / r, 1);
+  for(uint32_t t = 0; ; t += step) {
+    if(t > span) t = span; // Always end on endAngle.
+    vga_angle_t a = (vga_angle_t)(a0 + t);
+    int x = (xradius * vga_cos(a) + VGA_Q15_ONE / 2) >> 15;
+    int y = (yradius * vga_sin(a) + VGA_Q15_ONE / 2) >> 15;
+    drawPixel(xcenter + x, ycenter - y, foreground_color);
+    if(t == span) break;
+  }
 }
 
 //==================================================================
@@ -1309,6 +3151,8 @@ FLASHMEM void FlexIO2VGA::drawEllipse(int16_t cx, int16_t cy, int16_t radius1, i
   int x = -radius1, y = 0, err = 2-2*radius1, e2;
   float K = 0, rad1 = 0, rad2 = 0;
 
+  if(clipOutside(cx - radius1, cy - radius2, cx + radius1, cy + radius2)) return;
+
   rad1 = radius1;
   rad2 = radius2;
 
@@ -1361,48 +3205,16 @@ FLASHMEM void FlexIO2VGA::drawEllipse(int16_t cx, int16_t cy, int16_t radius1, i
 // fillcolor  : specifies the Color to use for Fill the Ellipse.
 //==================================================================
 FLASHMEM void FlexIO2VGA::fillEllipse(int16_t cx, int16_t cy, int16_t radius1, int16_t radius2, uint8_t fillcolor){
-  int x = -radius1, y = 0, err = 2-2*radius1, e2;
-  float K = 0, rad1 = 0, rad2 = 0;
-
-  rad1 = radius1;
-  rad2 = radius2;
-
-  if (radius1 > radius2)
-  {
-    do {
-      K = (float)(rad1/rad2);
-      draw_v_line((cx+x), (cy-(uint16_t)(y/K)), (2*(uint16_t)(y/K) + 1) , fillcolor);
-      draw_v_line((cx-x), (cy-(uint16_t)(y/K)), (2*(uint16_t)(y/K) + 1) , fillcolor);
-
-      e2 = err;
-      if (e2 <= y)
-      {
-        err += ++y*2+1;
-        if (-x == y && e2 <= x) e2 = 0;
-      }
-      if (e2 > x) err += ++x*2+1;
-
-    }
-    while (x <= 0);
-  }
-  else
-  {
-    y = -radius2;
-    x = 0;
-    do {
-      K = (float)(rad2/rad1);
-      draw_h_line((cx-(uint16_t)(x/K)), (cy+y), (2*(uint16_t)(x/K) + 1) , fillcolor);
-      draw_h_line((cx-(uint16_t)(x/K)), (cy-y), (2*(uint16_t)(x/K) + 1) , fillcolor);
-
-      e2 = err;
-      if (e2 <= x)
-      {
-        err += ++x*2+1;
-        if (-y == x && e2 <= y) e2 = 0;
-      }
-      if (e2 > y) err += ++y*2+1;
-    }
-    while (y <= 0);
+  int64_t a2 = (int32_t)radius1 * radius1;
+  int64_t b2 = (int32_t)radius2 * radius2;
+  int x = radius1;
+
+  if(clipOutside(cx - radius1, cy - radius2, cx + radius1, cy + radius2)) return;
+  // One span per row pair, x shrinks as y grows.
+  for(int y = 0; y <= radius2; y++) {
+    while((x > 0) && ((x * x * b2) + (y * y * a2) > (a2 * b2))) x--;
+    drawHLine(cy + y, cx - x, cx + x, fillcolor);
+    if(y != 0) drawHLine(cy - y, cx - x, cx + x, fillcolor);
   }
 }
 
@@ -1413,6 +3225,7 @@ FLASHMEM void FlexIO2VGA::drawRrect(int16_t x1, int16_t y1, int16_t x2, int16_t
   
   if(x1 > x2) { x = x1; x1 = x2; x2 = x; }
   if(y1 > y2) { y = y1; y1 = y2; y2 = y; }
+  if(clipOutside(x1, y1, x2, y2)) return;
   r = min((r | 0), min((x2-x1)/2, (y2-y1)/2));
 
   uint16_t cx1 = x1 + r;
@@ -1454,6 +3267,7 @@ FLASHMEM void FlexIO2VGA::fillRrect(int16_t x1, int16_t y1, int16_t x2, int16_t
   
   if(x1 > x2) { x = x1; x1 = x2; x2 = x; }
   if(y1 > y2) { y = y1; y1 = y2; y2 = y; }
+  if(clipOutside(x1, y1, x2, y2)) return;
   r = min((r | 0), min((x2-x1)/2, (y2-y1)/2));
 
   uint16_t cx1 = x1 + r;
@@ -1482,109 +3296,152 @@ FLASHMEM void FlexIO2VGA::fillRrect(int16_t x1, int16_t y1, int16_t x2, int16_t
   }
 }
 
+//=====================================================
+// Clip a copy, the source to the screen and the
+// destination to the clip rectangle, moving the other
+// corner to match. Returns false if nothing is left.
+//=====================================================
+FLASHMEM bool FlexIO2VGA::clipCopy(int *s_x, int *s_y, int *d_x, int *d_y, int *w, int *h) {
+  // 1) adjust position and size of source area according to screen size
+  if(*s_x < 0) {
+    *w += *s_x;
+    *d_x -= *s_x;
+    *s_x = 0;
+  }
+  if(*s_y < 0) {
+    *h += *s_y;
+    *d_y -= *s_y;
+    *s_y = 0;
+  }
+  if((*s_x + *w) >= fb_width) *w = fb_width - *s_x;
+  if((*s_y + *h) >= fb_height) *h = fb_height - *s_y;
+  // 2) adjust destination position and source size according to clip rectangle
+  if(*d_x < clipArea.x0) {
+    *w -= clipArea.x0 - *d_x;
+    *s_x += clipArea.x0 - *d_x;
+    *d_x = clipArea.x0;
+  }
+  if(*d_y < clipArea.y0) {
+    *h -= clipArea.y0 - *d_y;
+    *s_y += clipArea.y0 - *d_y;
+    *d_y = clipArea.y0;
+  }
+  if((*d_x + *w) > (clipArea.x1 + 1)) *w = clipArea.x1 + 1 - *d_x;
+  if((*d_y + *h) > (clipArea.y1 + 1)) *h = clipArea.y1 + 1 - *d_y;
+  return (*w > 0) && (*h > 0);
+}
+
+//===================================================
+// Copy w pixels of a row, see blit.h.
+//===================================================
+inline void FlexIO2VGA::copyRow(uint8_t *dst, int dx, const uint8_t *src, int sx, int w) {
+  if(bpp == 1) vga_copy_row1(dst, dx, src, sx, w);
+  else vga_copy_row4(dst, dx, src, sx, w);
+}
+
 // ------------------------------------------------------
 // copy area s_x,s_y of w*h pixels to destination d_x,d_y
+// Areas may overlap. Rows are copied whole bytes at a
+// time (see blit.h), bottom up when moving down.
 // ------------------------------------------------------
 FLASHMEM void FlexIO2VGA::copy(int s_x, int s_y, int d_x, int d_y, int w, int h) {
-  int c_s_x;
-  int c_s_y;
-  int c_d_x;
-  int c_d_y;
-  int c_w;
-  int c_h;
-  int error;
-  int sxpos;
-  int sypos;
-  int dxpos;
-  int dypos;
-  int dx;
-  int dy;
-  uint8_t c = 0;  
-  int off_x;
-  int off_y;
-
   // nothing to copy ?
   if((w <= 0) || (h <= 0)) return;
-  
-  c_s_x = s_x;
-  c_s_y = s_y;
-  c_d_x = d_x;
-  c_d_y = d_y;
-  c_w = w;
-  c_h = h;
-
-  // let's do some clipping to avoid overflow
-  // 1) adjust position and size of source area according to screen size
-  if(c_s_x < 0) {
-    c_w += c_s_x;
-    c_d_x -= c_s_x;
-    c_s_x = 0;
-  }
-  if(c_s_y < 0) {
-    c_h += c_s_y;
-    c_d_x -= c_s_y;
-    c_s_y = 0;
-  }
-  error = c_s_x + c_w;
-  if(error >= fb_width) c_w = fb_width - c_s_x;
-  error = c_s_y + c_h;
-  if(error >= fb_height) c_h = fb_height - c_s_y;
-  // 2) adjust destination position and source size according to screen size
-  if(c_d_x < 0) {
-    c_w += c_d_x;
-    c_s_x -= c_d_x;
-    c_d_x = 0;
-  }
-  if(c_d_y < 0) {
-    c_h += c_d_y;
-    c_s_y -= c_d_y;
-    c_d_y = 0;
-  }
-  error = c_d_x + c_w;
-  if(error >= fb_width) c_w = fb_width - c_d_x;
-  error = c_d_y + c_h;
-  if(error >= fb_height) c_h = fb_height - c_d_y;
-
-  // nothing left to copy ?
-  if((c_w <= 0) || (c_h <= 0)) return;
-
-  if(c_d_y > c_s_y) {
-    // copy from last line FIXED for scroll down
-    sypos = c_s_y + c_h - 1;
-    dypos = c_d_y + c_h - 1;
-    dy = -1;
-  } else {
-    // copy from first line
-    sypos = c_s_y;
-    dypos = c_d_y;
-    dy = 1;
-  }
-  if(c_d_x > c_s_x) {
-      // copy from last line pixel FIXED for scroll left and right.
-      sxpos = c_s_x + c_w;// - 1;
-      dxpos = c_d_x + c_w;// - 1;
-      dx = -1;
-  } else {
-    // copy from first line pixel
-    sxpos = c_s_x;
-    dxpos = c_d_x;
-    dx = 1;
+  if(!clipCopy(&s_x, &s_y, &d_x, &d_y, &w, &h)) return;
+
+  _fb = s_frameBuffer[frameBufferIndex];
+  // Let async ops on these rows finish first.
+  int top = (s_y < d_y) ? s_y : d_y;
+  int bottom = ((s_y > d_y) ? s_y : d_y) + h;
+  if(hw_scroll) {
+    top = 0;
+    bottom = fb_height;
   }
-  
-  // Do copy...
-  for(off_y = 0; off_y < c_h; off_y++) {
-    for(off_x = 0; off_x < c_w; off_x++) {
-      // Get existing gpixel info (byte).
-      c = getByte((sxpos + off_x * dx)/2, sypos + off_y * dy);
-      // Bit == 0 == 1 then get high nibble else get low nibble.
-      if(off_x & 1) 
-      // Shift high nibble to low nibble and mask out high nibble.
-        drawPixel((dxpos + off_x * dx), dypos + off_y * dy,GET_L_NIBBLE(c));
-      else
-      // Shift high nibble to low nibble and mask out high nibble.
-        drawPixel((dxpos + off_x * dx), dypos + off_y * dy,GET_R_NIBBLE(c));
-    }
+  while(dmaPending(&_fb[top*_pitch], &_fb[bottom*_pitch])) yield();
+
+  int first = 0;
+  int step = 1;
+  if(d_y > s_y) {
+    // copy from last line
+    first = h - 1;
+    step = -1;
+  }
+  for(int i = 0, y = first; i < h; i++, y += step) {
+    int srow = fbRow(s_y + y);
+    int drow = fbRow(d_y + y);
+    copyRow(&_fb[drow*_pitch], d_x, &_fb[srow*_pitch], s_x, w);
+    setDirty(drow, drow);
+  }
+}
+
+//=====================================================
+// Copy an area asynchronously. Whole bytes (even x and
+// w, or multiples of 8 in 1 bit mode) are copied by
+// DMA, anything else is done by copy() at once.
+// Returns a fence like fillRectAsync().
+//=====================================================
+FLASHMEM uint32_t FlexIO2VGA::copyAsync(int s_x, int s_y, int d_x, int d_y, int w, int h,
+                                        vga_job_t done, void *arg) {
+  int ppb = 8 / bpp; // Pixels per byte.
+  if((w > 0) && (h > 0) && clipCopy(&s_x, &s_y, &d_x, &d_y, &w, &h) &&
+     !hw_scroll && !(s_x % ppb) && !(d_x % ppb) && !(w % ppb)) {
+    _fb = s_frameBuffer[frameBufferIndex];
+    dma_op *op = dmaSlot();
+    op->src = &_fb[s_y*_pitch + s_x/ppb];
+    op->dst = &_fb[d_y*_pitch + d_x/ppb];
+    op->bytes = w / ppb;
+    op->rows = h;
+    uint32_t align = (uintptr_t)op->src | (uintptr_t)op->dst | op->bytes | _pitch;
+    op->size = (align & 3) ? ((align & 1) ? 1 : 2) : 4;
+    op->flags = 0;
+    op->done = done;
+    op->arg = arg;
+    return submitDma();
+  }
+  copy(s_x, s_y, d_x, d_y, w, h);
+  if(done) done(arg);
+  return 0;
+}
+
+//=====================================================
+// Bytes needed by saveRect() for a w*h pixel area.
+//=====================================================
+FLASHMEM uint32_t FlexIO2VGA::rectBytes(int w, int h) {
+  return ((w * bpp + 7) / 8) * h;
+}
+
+//=====================================================
+// Save a w*h pixel area to buf (rectBytes(w, h) bytes,
+// rows packed from pixel 0). Returns -1 if the area
+// is not all on screen or there is no frame buffer.
+//=====================================================
+FLASHMEM int FlexIO2VGA::saveRect(int x, int y, int w, int h, uint8_t *buf) {
+  if((w <= 0) || (h <= 0) || (x < 0) || (y < 0) ||
+     ((x + w) > fb_width) || ((y + h) > fb_height) || noFrameBuffer()) return -1;
+  _fb = s_frameBuffer[frameBufferIndex];
+  int bw = (w * bpp + 7) / 8;
+  for(int i = 0; i < h; i++) {
+    copyRow(&buf[i*bw], 0, &_fb[fbRow(y + i)*_pitch], x, w);
+  }
+  return 0;
+}
+
+//=====================================================
+// Put back an area saved by saveRect(). Returns -1 if
+// the area is not all on screen or there is no frame
+// buffer.
+//=====================================================
+FLASHMEM int FlexIO2VGA::restoreRect(int x, int y, int w, int h, const uint8_t *buf) {
+  if((w <= 0) || (h <= 0) || (x < 0) || (y < 0) ||
+     ((x + w) > fb_width) || ((y + h) > fb_height) || noFrameBuffer()) return -1;
+  _fb = s_frameBuffer[frameBufferIndex];
+  int bw = (w * bpp + 7) / 8;
+  for(int i = 0; i < h; i++) {
+    int row = fbRow(y + i);
+    copyRow(&_fb[row*_pitch], x, &buf[i*bw], 0, w);
+    setDirty(row, row);
   }
+  return 0;
 }
 
 //================
@@ -1601,8 +3458,7 @@ FLASHMEM void FlexIO2VGA::init() {
 FLASHMEM void FlexIO2VGA::init_text_settings() {
   _fb = s_frameBuffer[frameBufferIndex];
    
-  set_next_buffer(s_frameBuffer[frameBufferIndex], _pitch, false);
-  bpp = 4;
+  set_next_buffer(s_frameBuffer[displayIndex], _pitch, false);
   cursor_x = 0;
   cursor_y = 0;
 
@@ -1619,8 +3475,12 @@ FLASHMEM void FlexIO2VGA::init_text_settings() {
 
   foreground_color = VGA_BRIGHT_WHITE;
   background_color = VGA_BLUE;
-  SaveRVFGC = VGA_BRIGHT_WHITE;
-  SaveRVBGC = VGA_BLUE;
+  if(bpp == 1) {
+    foreground_color = mono_fg;
+    background_color = mono_bg;
+  }
+  SaveRVFGC = foreground_color;
+  SaveRVBGC = background_color;
   transparent_background = false;
   clear(background_color);
 
@@ -1635,13 +3495,15 @@ FLASHMEM void FlexIO2VGA::init_text_settings() {
 // Get a character from frame buffer:
 // x = starting x position in frame buffer.
 // y = starting y position in frame buffer.
-// font_width / 2 (2 pixels per byte).
+// font_width / 2 (2 pixels per byte, 8 in 1 bpp mode).
 // font_height * 2 (compensate for font_width / 2).
 //====================================================
 FLASHMEM void FlexIO2VGA::getChar(int16_t x, int16_t y, uint8_t *buf) {
+  if(noFrameBuffer()) return;
+  int16_t bw = font_width*bpp/8;
   for(int16_t i = 0; i < font_height*2; i++) {
-    for(int16_t j = 0; j < (font_width/2); j++) {
-      *buf++ = getByte((x * font_width/2)+j, (y * font_height)+i);
+    for(int16_t j = 0; j < bw; j++) {
+      *buf++ = getByte((x * bw)+j, (y * font_height)+i);
     }
   }
 }
@@ -1650,13 +3512,15 @@ FLASHMEM void FlexIO2VGA::getChar(int16_t x, int16_t y, uint8_t *buf) {
 // Write a character to frame buffer:
 // x = starting x position in frame buffer.
 // y = starting y position in frame buffer.
-// font_width / 2 (2 pixels per byte).
+// font_width / 2 (2 pixels per byte, 8 in 1 bpp mode).
 // font_height * 2 (compensate for font_width / 2).
 //====================================================
 FLASHMEM void FlexIO2VGA::putChar(int16_t x, int16_t y, uint8_t *buf) {
+  if(noFrameBuffer()) return;
+  int16_t bw = font_width*bpp/8;
   for(int16_t i = 0; i < font_height*2; i++) {
-    for(int16_t j = 0; j < (font_width/2); j++) {
-      putByte((x * font_width/2)+j, (y * font_height)+i, *buf++);
+    for(int16_t j = 0; j < bw; j++) {
+      putByte((x * bw)+j, (y * font_height)+i, *buf++);
     }
   }
 }
@@ -1671,9 +3535,10 @@ FLASHMEM void FlexIO2VGA::putChar(int16_t x, int16_t y, uint8_t *buf) {
 // Note: Mouse pointer size is always fixed at 8x16.
 //====================================================
 FLASHMEM void FlexIO2VGA::getGptr(int16_t x, int16_t y, uint8_t *buf) {
+  int16_t bw = font_width*bpp/8;
   for(int16_t i = 0; i < font_height*2+1; i++) {
-    for(int16_t j = 0; j < (font_width/2)+1; j++) {
-      *buf++ = getByte((x/2)+j, y+i);
+    for(int16_t j = 0; j < bw+1; j++) {
+      *buf++ = getByte((x*bpp/8)+j, y+i);
     }
   }
 }
@@ -1689,9 +3554,10 @@ FLASHMEM void FlexIO2VGA::getGptr(int16_t x, int16_t y, uint8_t *buf) {
 // Note: Mouse pointer size is always fixed at 8x16.
 //====================================================
 FLASHMEM void FlexIO2VGA::putGptr(int16_t x, int16_t y, uint8_t *buf) {
+  int16_t bw = font_width*bpp/8;
   for(int16_t i = 0; i < font_height*2+1; i++) {
-    for(int16_t j = 0; j < (font_width/2)+1; j++) {
-      putByte((x/2)+j, y+i, *buf++);
+    for(int16_t j = 0; j < bw+1; j++) {
+      putByte((x*bpp/8)+j, y+i, *buf++);
     }
   }
 }
@@ -1700,30 +3566,36 @@ FLASHMEM void FlexIO2VGA::putGptr(int16_t x, int16_t y, uint8_t *buf) {
 // getByte()
 // Each pixel is 4bits. One byte is returned
 // which represents two pixels. High and low
-// nibbles.
+// nibbles. In 1 bpp mode a byte is 8 pixels.
 //==========================================
 FLASHMEM uint8_t FlexIO2VGA::getByte(uint32_t x, uint32_t y) {
-
+  if(noFrameBuffer()) return 0;
   _fb = s_frameBuffer[frameBufferIndex];
-  return _fb[(y*_pitch)+x];
+  return _fb[(fbRow(y)*_pitch)+x];
 }
 
 //==========================================
 // putByte()
 // Each pixel is 4bits. One byte is written
 // which represents two pixels. High and low
-// nibbles.
+// nibbles. In 1 bpp mode a byte is 8 pixels.
 //==========================================
 FLASHMEM  void FlexIO2VGA::putByte(uint32_t x, uint32_t y, uint8_t byte) {
+  if(noFrameBuffer()) return;
   _fb = s_frameBuffer[frameBufferIndex];
+  y = fbRow(y);
   _fb[(y*_pitch)+x] = byte;
+  setDirty(y, y);
 }
 
 //=======================================
 //  Write a count bytes to linear memory.
 //=======================================
 FLASHMEM void FlexIO2VGA::writeVmem(uint8_t *buf, uint32_t vMem, uint32_t count) {
+  if((count == 0) || noFrameBuffer()) return;
   _fb = s_frameBuffer[frameBufferIndex] + vMem;
+  uint32_t y2 = (vMem + count - 1) / _pitch;
+  setDirty(vMem / _pitch, (y2 > (uint32_t)fb_height) ? fb_height : y2);
   while(count) {
     *_fb++ = *buf++;
     count--;
@@ -1734,6 +3606,7 @@ FLASHMEM void FlexIO2VGA::writeVmem(uint8_t *buf, uint32_t vMem, uint32_t count)
 //  Read a count bytes from linear memory.
 //========================================
 FLASHMEM void FlexIO2VGA::readVmem(uint32_t vMem, uint8_t *buf, int32_t count) {
+  if(noFrameBuffer()) return;
   _fb = s_frameBuffer[frameBufferIndex] + vMem;
   while(count) {
     *buf++ = *_fb++;
@@ -1778,6 +3651,16 @@ FLASHMEM int FlexIO2VGA::fontLoadMem(uint8_t *font) {
   return (int)0;
 }
 
+//===========================================
+// Reverse the bit order of a byte.
+//===========================================
+static inline uint8_t bit_reverse(uint8_t b) {
+  b = ((b & 0xf0) >> 4) | ((b & 0x0f) << 4);
+  b = ((b & 0xcc) >> 2) | ((b & 0x33) << 2);
+  b = ((b & 0xaa) >> 1) | ((b & 0x55) << 1);
+  return b;
+}
+
 //===========================================
 // Draw a string. Default to right direction.
 //===========================================
@@ -1802,27 +3685,39 @@ FLASHMEM void FlexIO2VGA::drawText(int16_t x, int16_t y, const char * text, uint
     else
 //      charPointer = &font_8x16[t*font_height];
       charPointer = &currentFont[t*font_height]; // currentFont[] is a loadable font buffer.
-    for(j = 0; j < font_height; j++) {
-      b = *charPointer++;
-      for(i = 0; i < font_width; i++) {
-       pix = b & (128 >> i);
-        // pixel to draw or non transparent background color ?
-        if((pix) || (bgcolor != -1)) {
-          switch(dir) {
-            case VGA_DIR_RIGHT:
-              drawPixel(x + i, y + j, (pix ? fgcolor : bgcolor));
-              break;
-            case VGA_DIR_TOP:
-              drawPixel(x + j, y - i, (pix ? fgcolor : bgcolor));
-              break;
-            case VGA_DIR_LEFT:
-              drawPixel(x - i, y - j, (pix ? fgcolor : bgcolor));
-              break;
-            case VGA_DIR_BOTTOM:
-              drawPixel(x - j, y + i, (pix ? fgcolor : bgcolor));
-              break;
-          }
-	    }
+    if((bpp == 1) && (dir == VGA_DIR_RIGHT) && !(x & 7) && (x >= clipArea.x0) &&
+       ((x + font_width) <= (clipArea.x1 + 1)) && (y >= clipArea.y0) &&
+       ((y + font_height) <= (clipArea.y1 + 1))) {
+      // Byte aligned 1 bpp text, one byte per character row.
+      uint8_t fg = monoByte(fgcolor);
+      uint8_t bg = monoByte(bgcolor);
+      for(j = 0; j < font_height; j++) {
+        b = bit_reverse(*charPointer++); // Font MSB is leftmost pixel.
+        putByte(x/8, y + j, (b & fg) | (~b & bg));
+      }
+    } else {
+      for(j = 0; j < font_height; j++) {
+        b = *charPointer++;
+        for(i = 0; i < font_width; i++) {
+         pix = b & (128 >> i);
+          // pixel to draw or non transparent background color ?
+          if((pix) || (bgcolor != -1)) {
+            switch(dir) {
+              case VGA_DIR_RIGHT:
+                drawPixel(x + i, y + j, (pix ? fgcolor : bgcolor));
+                break;
+              case VGA_DIR_TOP:
+                drawPixel(x + j, y - i, (pix ? fgcolor : bgcolor));
+                break;
+              case VGA_DIR_LEFT:
+                drawPixel(x - i, y - j, (pix ? fgcolor : bgcolor));
+                break;
+              case VGA_DIR_BOTTOM:
+                drawPixel(x - j, y + i, (pix ? fgcolor : bgcolor));
+                break;
+            }
+	      }
+        }
       }
     }
     switch(dir) {
@@ -1847,6 +3742,7 @@ FLASHMEM void FlexIO2VGA::drawText(int16_t x, int16_t y, const char * text, uint
 // x, y, width and height are in characters.
 //==========================================
 FLASHMEM void FlexIO2VGA::setPrintCWindow(uint8_t x, uint8_t y, uint8_t width, uint8_t height) {
+  if(hw_scroll) setHardwareScroll(false);
   if(x < 0) {
     print_window_x = 0;
   } else if(x >= ((fb_width / font_width) - font_width)) {
@@ -1873,6 +3769,7 @@ FLASHMEM void FlexIO2VGA::setPrintCWindow(uint8_t x, uint8_t y, uint8_t width, u
 // x, y, width and height are in pixels.
 //=========================================
 FLASHMEM void FlexIO2VGA::setPrintWindow(int x, int y, int width, int height) {
+  if(hw_scroll) setHardwareScroll(false);
   if(x < 0)
     print_window_x = 0;
   else if(x >= (fb_width - font_width))
@@ -1891,10 +3788,10 @@ FLASHMEM void FlexIO2VGA::setPrintWindow(int x, int y, int width, int height) {
   print_window_h = height / font_height / (double_height ? 2:1);
 }
 
-//==================================================
-// Clear a text window to current backgraound color.
-//==================================================
-FLASHMEM void FlexIO2VGA::clearPrintWindow() {
+//=====================================================
+// Get the rectangle cleared by clearPrintWindow().
+//=====================================================
+FLASHMEM void FlexIO2VGA::printWindowRect(int *x0, int *y0, int *x1, int *y1) {
   //=====================================================
   // Clear the character print window in 800x600 mode
   // with a font height of 16 needs fb_height adjusted
@@ -1910,10 +3807,19 @@ FLASHMEM void FlexIO2VGA::clearPrintWindow() {
   } else {
     adjust = font_height; // Normal defined print window less than 800x600.
   }
+  *x0 = print_window_x;
+  *y0 = print_window_y;
+  *x1 = print_window_x + (print_window_w) * font_width;
+  *y1 = print_window_y + (print_window_h) * adjust;
+}
 
-  fillRect(print_window_x, print_window_y, print_window_x +
-          (print_window_w) * font_width, print_window_y +
-          (print_window_h) * adjust, background_color);
+//==================================================
+// Clear a text window to current backgraound color.
+//==================================================
+FLASHMEM void FlexIO2VGA::clearPrintWindow() {
+  int x0, y0, x1, y1;
+  printWindowRect(&x0, &y0, &x1, &y1);
+  fillRect(x0, y0, x1, y1, background_color);
   cursor_x = 0;
   cursor_y = 0;
   getChar(tCursorX(),tCursorY(),tCursor.char_under_cursor);
@@ -1924,6 +3830,7 @@ FLASHMEM void FlexIO2VGA::clearPrintWindow() {
 // Unset a text window.
 //=====================
 FLASHMEM void FlexIO2VGA::unsetPrintWindow() {
+  if(hw_scroll) setHardwareScroll(false);
   print_window_x = 0;
   print_window_y = 0;
   print_window_w = fb_width / font_width;
@@ -1934,8 +3841,20 @@ FLASHMEM void FlexIO2VGA::unsetPrintWindow() {
 // Scroll up text one row. (Slow!)
 // Set font_height to "-font_height" (negative)
 // to scroll up one row.
+// With hardware scroll enabled only the new
+// bottom row is cleared.
 //=========================================
 FLASHMEM void FlexIO2VGA::scrollUpPrintWindow() {
+  if(hw_scroll) {
+    // Remap first so the row cleared below is already
+    // shown at the bottom.
+    scroll_offset += font_height;
+    if(scroll_offset >= scroll_rows) scroll_offset -= scroll_rows;
+    scrollMap();
+    fillRect(0, scroll_top + scroll_rows - font_height, fb_width - 1,
+             scroll_top + scroll_rows - 1, background_color);
+    return;
+  }
   // move the 2nd row and the following ones one row up
   Vscroll(print_window_x, print_window_y + font_height, 
   (print_window_w) * font_width * (double_width ? 2:1), (print_window_h - 1) *
@@ -1948,12 +3867,121 @@ FLASHMEM void FlexIO2VGA::scrollUpPrintWindow() {
 // to scroll down one line.
 //=========================================
 FLASHMEM void FlexIO2VGA::scrollDownPrintWindow() {
+  if(hw_scroll) {
+    // Remap first so the row cleared below is already
+    // shown at the top.
+    scroll_offset -= font_height;
+    if(scroll_offset < 0) scroll_offset += scroll_rows;
+    scrollMap();
+    fillRect(0, scroll_top, fb_width - 1, scroll_top + font_height - 1,
+             background_color);
+    return;
+  }
   // move the 2nd line and the following ones one line down
   Vscroll(print_window_x, print_window_y, 
   (print_window_w) * font_width, (print_window_h - 1) * font_height,
   font_height, background_color);
 }
 
+//==================================================
+// Point the lines of the hardware scroll window at
+// their rows for scroll_offset. Takes effect on the
+// next line fetched.
+//==================================================
+void FlexIO2VGA::scrollMap(void) {
+  uint8_t repeat = double_height ? 2:1;
+  vga_map_lines(lineTcd, scroll_top*repeat, scroll_rows*repeat,
+                lineTableBase + scroll_top*_pitch, _pitch, scroll_offset,
+                scroll_rows, repeat);
+  lineFlush(scroll_top*repeat, scroll_rows*repeat);
+}
+
+//==================================================
+// Copy a row to dst and point display lines 'line'
+// to line+repeat-1 at the copy, so the screen keeps
+// showing the same pixels.
+//==================================================
+static void move_row(uint8_t *dst, const uint8_t *src, size_t pitch,
+                     uint16_t line, uint8_t repeat) {
+  memcpy(dst, src, pitch);
+  arm_dcache_flush(dst, pitch);
+  vga_map_lines(lineTcd, line, repeat, (uint32_t)dst, pitch, 0, 1, repeat);
+  lineFlush(line, repeat);
+}
+
+//==================================================
+// Enable or disable hardware scrolling of the print
+// window. Scrolling then only changes the line the
+// scanout starts the window at, and clears the new
+// text row. Uses the per scanline table.
+// The print window must be full width and only one
+// buffer can be in use. Disabling (or changing the
+// print window) puts the rows back in order.
+// Returns -1 if the window or mode can't be used.
+//==================================================
+FLASHMEM int FlexIO2VGA::setHardwareScroll(bool enable) {
+  if(!enable) {
+    if(!hw_scroll) return 0;
+    // The cursors are drawn through scroll_offset.
+    bool tActive = tCursor.active;
+    bool gActive = gCursor.active;
+    if(tActive) tCursorOff();
+    if(gActive) gCursorOff();
+    waitDma();
+    _fb = s_frameBuffer[frameBufferIndex];
+    // Rotate the ring back so row order matches the screen,
+    // one cycle of rows at a time. Each row's display lines
+    // follow it as it moves, so the screen never shows a row
+    // out of place. The spare row after the buffer holds the
+    // first row of each cycle.
+    if(scroll_offset) {
+      int n = scroll_rows;
+      int k = scroll_offset;
+      uint8_t repeat = double_height ? 2:1;
+      uint8_t *ring = _fb + scroll_top*_pitch;
+      uint8_t *spare = _fb + fb_height*_pitch;
+      int moved = 0;
+      // Row p holds screen row (p - k) mod n.
+      for(int first = 0; moved < n; first++) {
+        move_row(spare, &ring[first*_pitch], _pitch,
+                 (scroll_top + (first - k + n) % n)*repeat, repeat);
+        int j = first;
+        for(;;) {
+          int src = (j + k) % n;
+          moved++;
+          if(src == first) break;
+          move_row(&ring[j*_pitch], &ring[src*_pitch], _pitch,
+                   (scroll_top + j)*repeat, repeat);
+          j = src;
+        }
+        move_row(&ring[j*_pitch], spare, _pitch, (scroll_top + j)*repeat, repeat);
+      }
+    }
+    __disable_irq();
+    hw_scroll = false;
+    scroll_offset = 0;
+    __enable_irq();
+    if(tActive) tCursorOn();
+    if(gActive) gCursorOn();
+    return 0;
+  }
+  if(hw_scroll) return 0;
+  if((numBuffers > 1) || lbLayers || noFrameBuffer()) return -1;
+  if((print_window_x != 0) ||
+     ((print_window_w * font_width * (double_width ? 2:1)) < fb_width)) return -1;
+  int rows = print_window_h * font_height;
+  if(rows > (fb_height - print_window_y)) rows = fb_height - print_window_y;
+  if(rows <= font_height) return -1;
+  if(!line_table && (setLineTable(true) < 0)) return -1;
+  __disable_irq();
+  scroll_top = print_window_y;
+  scroll_rows = rows;
+  scroll_offset = 0;
+  hw_scroll = true;
+  __enable_irq();
+  return 0;
+}
+
 //=============================================
 // Scroll right text one column. (Slow!)
 // Set font_width to "-font_width" (negative)
@@ -1993,9 +4021,13 @@ FLASHMEM void FlexIO2VGA::updateTCursor(int column, int line) {
 // based on font sizes 8x8 or 8x16. (8x16 max)
 //================================================
 FLASHMEM void FlexIO2VGA::drawTcursor(int color) {
+  // Cursors are not clipped. This may be called from the
+  // frame interrupt, so the clip rectangle is put back.
+  clip_rect saved = clipScreen();
   fillRect(tCursor.tCursor_x+tCursor.x_start, tCursor.tCursor_y+tCursor.y_start,
            tCursor.tCursor_x+tCursor.x_end-1, tCursor.tCursor_y+tCursor.y_end-1,
            color);
+  clipArea = saved;
 }
 
 //=========================================
@@ -2030,14 +4062,16 @@ FLASHMEM void FlexIO2VGA::textxy(int column, int line) {
 //================================================
 FLASHMEM void FlexIO2VGA::drawGcursor(int color) {
   if(gCursor.active) {
+    clip_rect saved = clipScreen(); // Cursors are not clipped.
     getGptr(gCursor.gCursor_x,gCursor.gCursor_y,gCursor.char_under_cursor);
     if(gCursor.type == BLOCK_CURSOR) {
       fillRect(gCursor.gCursor_x+gCursor.x_start, gCursor.gCursor_y+gCursor.y_start,
                gCursor.gCursor_x+gCursor.x_end-1, gCursor.gCursor_y+gCursor.y_end-1,
                gCursor.color);
     } else {
-      drawBitmap(gCursor.gCursor_x, gCursor.gCursor_y, (uint8_t *)arrow[gCursor.type], 8, 16);
+      drawPacked(gCursor.gCursor_x, gCursor.gCursor_y, &arrow[gCursor.type]);
     }
+    clipArea = saved;
   }
 }
 
@@ -2245,10 +4279,74 @@ FLASHMEM void FlexIO2VGA::clearStatusLine(uint8_t bgc) {
 
 //==========================================
 // Write frame buffer to VGA memory. (DMA)
+// Always the buffer being displayed.
+// Only rows marked dirty are flushed.
+// Does nothing without a frame buffer.
 //==========================================
 void FlexIO2VGA::fbUpdate(bool wait) {
-  arm_dcache_flush_delete(s_frameBuffer[frameBufferIndex], fb_height*_pitch);
-  set_next_buffer(s_frameBuffer[frameBufferIndex], _pitch, wait);
+  if(s_frameBuffer[displayIndex] == NULL) return;
+  frameFlushBytes += flushDirty(displayIndex);
+  set_next_buffer(s_frameBuffer[displayIndex], _pitch, wait);
+}
+
+//==================================================
+// Mark rows y1 to y2 of the drawing buffer as dirty.
+// Rows are clamped to screen. Call this after
+// writing to the buffer returned by getFB().
+//==================================================
+void FlexIO2VGA::markDirty(int y1, int y2) {
+  if(y1 > y2) SWAP(y1, y2);
+  if((y2 < 0) || (y1 > fb_height)) return;
+  if(y1 < 0) y1 = 0;
+  if(y2 > fb_height) y2 = fb_height;
+  setDirty(y1, y2);
+}
+
+//==================================================
+// Get number of bytes flushed from the data cache
+// during the last frame.
+//==================================================
+uint32_t FlexIO2VGA::getFlushBytes(void) { return lastFlushBytes; }
+
+//=====================================================
+// Flush the dirty bands of a frame buffer from the
+// data cache and clear them. Runs of adjacent bands
+// are flushed with one call.
+// Returns the number of bytes flushed (0 if clean).
+//=====================================================
+uint32_t FlexIO2VGA::flushDirty(uint32_t index) {
+  uint32_t bands;
+  uint32_t bytes = 0;
+  uint32_t size = fb_height*_pitch;
+  uint32_t bandSize = _pitch << dirtyShift;
+  uint32_t band = 0;
+
+  __disable_irq();
+  bands = dirtyBands[index];
+  dirtyBands[index] = 0;
+  __enable_irq();
+  // RAM1 is not cached.
+  if((fbMem == VGA_MEM_DTCM) || (s_frameBuffer[index] == NULL)) return 0;
+
+  while(bands) {
+    if(!(bands & 1)) {
+      bands >>= 1;
+      band++;
+      continue;
+    }
+    uint32_t first = band;
+    while(bands & 1) {
+      bands >>= 1;
+      band++;
+    }
+    uint32_t start = first * bandSize;
+    uint32_t end = band * bandSize;
+    if(end > size) end = size;
+    if(start >= end) break;
+    arm_dcache_flush_delete(s_frameBuffer[index] + start, end - start);
+    bytes += end - start;
+  }
+  return bytes;
 }
 
 //==================================================
@@ -2356,6 +4454,172 @@ FLASHMEM void FlexIO2VGA::reverseVid(bool onOff) {
   }
 }
 
+//=====================================================
+// Polygon edge for fillPolygon(). x is 32.32 fixed
+// point, at the row being filled. The step is rounded
+// down, with 32 fraction bits the error stays below
+// what could move a pixel edge.
+//=====================================================
+typedef struct {
+  int64_t x;
+  int64_t dx;      // x step per row.
+  int32_t top;     // Rows top <= y < bottom.
+  int32_t bottom;
+  int8_t  dir;     // 1 if the edge goes down, -1 up.
+} poly_edge;
+
+//=====================================================
+// Draw the outline of a polygon of n points.
+//=====================================================
+FLASHMEM void FlexIO2VGA::drawPolygon(const Point2D *points, int n, uint8_t color) {
+  if(n <= 0) return;
+  bool wasActive = false;
+  if(gCursor.active) {
+    gCursorOff(); // Must turn off software driven graphic cursor if on !!
+    wasActive = true;
+  }
+  if(n == 1) drawPixel(points[0].x, points[0].y, color);
+  // Each line leaves out its end, the next one starts there.
+  else for(int i = 0; i < n; i++) {
+    int j = (i + 1 < n) ? i + 1 : 0;
+    drawLine(points[i].x, points[i].y, points[j].x, points[j].y, color, true);
+  }
+  if(wasActive) gCursorOn();
+}
+
+//=====================================================
+// Fill a polygon of n points with an active edge table.
+// Edges are sorted by top row once, then each row adds
+// the edges starting there, drops the ones that ended,
+// keeps the active ones sorted by x and steps them.
+// A pixel is filled if its top left corner is inside,
+// so polygons sharing an edge don't overlap. Only rows
+// inside the bounding box and clip rectangle are visited.
+//=====================================================
+FLASHMEM int FlexIO2VGA::fillPolygon(const Point2D *points, int n, uint8_t color, uint8_t rule) {
+  if(n < 3) return 0;
+  int xmin = points[0].x, xmax = xmin;
+  int ymin = points[0].y, ymax = ymin;
+  for(int i = 1; i < n; i++) {
+    xmin = min(xmin, (int)points[i].x);
+    xmax = max(xmax, (int)points[i].x);
+    ymin = min(ymin, (int)points[i].y);
+    ymax = max(ymax, (int)points[i].y);
+  }
+  if(clipOutside(xmin, ymin, xmax, ymax)) return 0;
+
+  poly_edge stackEdges[POLY_STACK_EDGES];
+  poly_edge *stackActive[POLY_STACK_EDGES];
+  poly_edge *edges = stackEdges;
+  poly_edge **active = stackActive;
+  void *mem = NULL;
+  if(n > POLY_STACK_EDGES) {
+    mem = malloc(n * (sizeof(poly_edge) + sizeof(poly_edge *)));
+    if(mem == NULL) return -1;
+    edges = (poly_edge *)mem;
+    active = (poly_edge **)(edges + n);
+  }
+
+  // Edge table, sorted by top row. Horizontal edges are
+  // left out, the edges either side of them meet the fill.
+  int ne = 0;
+  for(int i = 0; i < n; i++) {
+    const Point2D *a = &points[i];
+    const Point2D *b = &points[(i + 1 < n) ? i + 1 : 0];
+    if(a->y == b->y) continue;
+    poly_edge e;
+    e.dir = 1;
+    if(a->y > b->y) {
+      const Point2D *t = a;
+      a = b;
+      b = t;
+      e.dir = -1;
+    }
+    e.top = a->y;
+    e.bottom = b->y;
+    int64_t num = (int64_t)(b->x - a->x) << 32;
+    e.x = (int64_t)a->x << 32;
+    e.dx = num / (b->y - a->y);
+    if((num < 0) && (e.dx * (b->y - a->y) != num)) e.dx--; // Round down.
+    int j = ne++;
+    while((j > 0) && (edges[j-1].top > e.top)) {
+      edges[j] = edges[j-1];
+      j--;
+    }
+    edges[j] = e;
+  }
+
+  bool wasActive = false;
+  if(gCursor.active) {
+    gCursorOff(); // Must turn off software driven graphic cursor if on !!
+    wasActive = true;
+  }
+  int y1 = min(ymax - 1, (int)clipArea.y1);
+  int next = 0; // Next edge in the table to go active.
+  int na = 0;   // Active edges.
+  for(int y = max(ymin, (int)clipArea.y0); y <= y1; y++) {
+    int k = 0;
+    for(int i = 0; i < na; i++) {
+      if(active[i]->bottom > y) active[k++] = active[i];
+    }
+    na = k;
+    while((next < ne) && (edges[next].top <= y)) {
+      poly_edge *e = &edges[next++];
+      if(e->bottom <= y) continue; // Ended above the clip rectangle.
+      e->x += e->dx * (y - e->top);
+      active[na++] = e;
+    }
+    // Insertion sort, the order rarely changes between rows.
+    for(int i = 1; i < na; i++) {
+      poly_edge *e = active[i];
+      int j = i;
+      while((j > 0) && (active[j-1]->x > e->x)) {
+        active[j] = active[j-1];
+        j--;
+      }
+      active[j] = e;
+    }
+    // Pixels ceil(left) to ceil(right) - 1 of each span.
+    if(rule == VGA_FILL_NONZERO) {
+      int wind = 0;
+      int64_t left = 0;
+      for(int i = 0; i < na; i++) {
+        if(wind == 0) left = active[i]->x;
+        wind += active[i]->dir;
+        if(wind == 0) {
+          int xa = (left + 0xffffffffLL) >> 32;
+          int xb = ((active[i]->x + 0xffffffffLL) >> 32) - 1;
+          if(xa <= xb) drawHLine(y, xa, xb, color);
+        }
+      }
+    } else {
+      for(int i = 0; (i + 1) < na; i += 2) {
+        int xa = (active[i]->x + 0xffffffffLL) >> 32;
+        int xb = ((active[i+1]->x + 0xffffffffLL) >> 32) - 1;
+        if(xa <= xb) drawHLine(y, xa, xb, color);
+      }
+    }
+    for(int i = 0; i < na; i++) active[i]->x += active[i]->dx;
+  }
+  if(wasActive) gCursorOn();
+  free(mem);
+  return 0;
+}
+
+//=====================================================
+// Copy the PolySet points, moved by (cx,cy). Returns
+// the number of points.
+//=====================================================
+static int polySetPoints(Point2D *pts, int16_t cx, int16_t cy) {
+  int n = 0;
+  while((n < MaxPolyPoint) && (PolySet.Pts[n].x < 10000)) {
+    pts[n].x = PolySet.Pts[n].x + cx;
+    pts[n].y = PolySet.Pts[n].y + cy;
+    n++;
+  }
+  return n;
+}
+
 //--------------------------------------------------------------
 //  Displays a Polygon.
 //  centerx			: are specified with PolySet.Center.x and y.
@@ -2366,23 +4630,12 @@ FLASHMEM void FlexIO2VGA::reverseVid(bool onOff) {
 //  polygon points  : are specified with PolySet.Pts[n].x and y 
 //  After the last polygon point , set PolySet.Pts[n + 1].x to 10000
 //  Max number of point for the polygon is set by MaxPolyPoint previously defined.
+//  Use drawPolygon() for any number of points.
 //--------------------------------------------------------------
 FLASHMEM void FlexIO2VGA::drawpolygon(int16_t cx, int16_t cy, uint8_t bordercolor){
-	uint8_t n = 1;
-	while((PolySet.Pts[n].x < 10000) && (n < MaxPolyPoint)){
-		drawLine(PolySet.Pts[n].x + cx, 
-	             PolySet.Pts[n].y + cy, 
-				 PolySet.Pts[n - 1].x + cx , 
-				 PolySet.Pts[n - 1].y + cy, 
-				 bordercolor, false);
-		n++;		
-	}
-	// close the polygon
-	drawLine(PolySet.Pts[0].x + cx, 
-	         PolySet.Pts[0].y + cy, 
-			 PolySet.Pts[n - 1].x + cx, 
-			 PolySet.Pts[n - 1].y + cy, 
-			 bordercolor, false);
+	Point2D pts[MaxPolyPoint];
+	int n = polySetPoints(pts, cx, cy);
+	drawPolygon(pts, n, bordercolor);
 }
 
 //--------------------------------------------------------------
@@ -2396,72 +4649,14 @@ FLASHMEM void FlexIO2VGA::drawpolygon(int16_t cx, int16_t cy, uint8_t bordercolo
 //  polygon points  : are specified with PolySet.Pts[n].x and y 
 //  After the last polygon point , set PolySet.Pts[n + 1].x to 10000
 //  Max number of point for the polygon is set by MaxPolyPoint previously defined.
+//  Use fillPolygon() for any number of points.
 //--------------------------------------------------------------
 FLASHMEM void FlexIO2VGA::drawfullpolygon(int16_t cx, int16_t cy, uint8_t fillcolor, uint8_t bordercolor){
-	int n,i,j,k,dy,dx;
-	int y,temp;
-	int a[MaxPolyPoint][2],xi[MaxPolyPoint];
-	float slope[MaxPolyPoint];
-
-    n = 0;
-
-	while((PolySet.Pts[n].x < 10000) && (n < MaxPolyPoint)){
-		a[n][0] = PolySet.Pts[n].x;
-		a[n][1] = PolySet.Pts[n].y;
-		n++;
-	}
-
-	a[n][0]=PolySet.Pts[0].x;
-	a[n][1]=PolySet.Pts[0].y;
-
-	for(i=0;i<n;i++)
-	{
-		dy=a[i+1][1]-a[i][1];
-		dx=a[i+1][0]-a[i][0];
-
-		if(dy==0) slope[i]=1.0;
-		if(dx==0) slope[i]=0.0;
-
-		if((dy!=0)&&(dx!=0)) /*- calculate inverse slope -*/
-		{
-			slope[i]=(float) dx/dy;
-		}
-	}
-
-	for(y=0;y< 480;y++)
-	{
-		k=0;
-		for(i=0;i<n;i++)
-		{
-
-			if( ((a[i][1]<=y)&&(a[i+1][1]>y))||
-					((a[i][1]>y)&&(a[i+1][1]<=y)))
-			{
-				xi[k]=(int)(a[i][0]+slope[i]*(y-a[i][1]));
-				k++;
-			}
-		}
-
-		for(j=0;j<k-1;j++) /*- Arrange x-intersections in order -*/
-			for(i=0;i<k-1;i++)
-			{
-				if(xi[i]>xi[i+1])
-				{
-					temp=xi[i];
-					xi[i]=xi[i+1];
-					xi[i+1]=temp;
-				}
-			}
-
-		for(i=0;i<k;i+=2)
-		{
-			drawLine(xi[i] + cx,y + cy,xi[i+1]+1 + cx,y + cy, fillcolor, false);
-		}
-
-	}
-
+	Point2D pts[MaxPolyPoint];
+	int n = polySetPoints(pts, cx, cy);
+	fillPolygon(pts, n, fillcolor, VGA_FILL_EVENODD);
 	// Draw the polygon outline
-	drawpolygon(cx , cy , bordercolor);
+	drawPolygon(pts, n, bordercolor);
 }
 
 //--------------------------------------------------------------
@@ -2474,43 +4669,33 @@ FLASHMEM void FlexIO2VGA::drawfullpolygon(int16_t cx, int16_t cy, uint8_t fillco
 //  polygon points  : are specified with PolySet.Pts[n].x and y 
 //  After the last polygon point , set PolySet.Pts[n + 1].x to 10000
 //  Max number of point for the polygon is set by MaxPolyPoint previously defined.
+//  PolySet is left as it is, the rotated points are kept
+//  on the stack.
 //--------------------------------------------------------------
 FLASHMEM void FlexIO2VGA::drawrotatepolygon(int16_t cx, int16_t cy, int16_t Angle, uint8_t fillcolor, uint8_t bordercolor, uint8_t filled)
 {
-	Point2D 	SavePts[MaxPolyPoint];
-	uint16_t	n = 0;
+	Point2D 	pts[MaxPolyPoint];
+	int		n = 0;
 	int16_t		ctx,cty;
-	float		raddeg = 3.14159 / 180;
-	float		angletmp;
-	float		tosquare;
-	float		ptsdist;
+	int32_t		x,y;
+	vga_affine_t	m;
 
 	ctx = PolySet.Center.x;
 	cty = PolySet.Center.y;
+	// Rotate all points around the center, then translate.
+	vga_affine_rotate(&m, vga_deg(Angle));
+	vga_affine_translate(&m, ctx + cx, cty + cy);
 	
-	while((PolySet.Pts[n].x < 10000) && (n < MaxPolyPoint)){
-		// Save Original points coordinates
-		SavePts[n] = PolySet.Pts[n];
-		// Rotate and save all points
-		tosquare = ((PolySet.Pts[n].x - ctx) * (PolySet.Pts[n].x - ctx)) + ((PolySet.Pts[n].y - cty) * (PolySet.Pts[n].y - cty));
-		ptsdist  = sqrtf(tosquare);
-		angletmp = atan2f(PolySet.Pts[n].y - cty,PolySet.Pts[n].x - ctx) / raddeg;
-		PolySet.Pts[n].x = (int16_t)((cosf((angletmp + Angle) * raddeg) * ptsdist) + ctx);
-		PolySet.Pts[n].y = (int16_t)((sinf((angletmp + Angle) * raddeg) * ptsdist) + cty);
+	while((n < MaxPolyPoint) && (PolySet.Pts[n].x < 10000)){
+		vga_affine_apply(&m, PolySet.Pts[n].x - ctx, PolySet.Pts[n].y - cty, &x, &y);
+		pts[n].x = x;
+		pts[n].y = y;
 		n++;
 	}	
 	
 	if(filled != 0)
-	  drawfullpolygon(cx , cy , fillcolor , bordercolor);
-    else
-	  drawpolygon(cx , cy , bordercolor);
-
-	// Get the original points back;
-	n=0;
-	while((PolySet.Pts[n].x < 10000) && (n < MaxPolyPoint)){
-		PolySet.Pts[n] = SavePts[n];
-		n++;
-	}	
+	  fillPolygon(pts, n, fillcolor, VGA_FILL_EVENODD);
+	drawPolygon(pts, n, bordercolor);
 }
 
 //==========================================================================================
@@ -2591,6 +4776,16 @@ FLASHMEM bool FlexIO2VGA::buttonJustReleased(struct Gbuttons *buttons) {
 
 extern FlexIO2VGA vga4bit;
 
+FASTRUN void FlexIO2VGA::RasterISR(void) {
+  vga4bit.RasterInterrupt();
+  asm volatile("dsb");
+}
+
+FASTRUN void FlexIO2VGA::DmaISR(void) {
+  vga4bit.DmaInterrupt();
+  asm volatile("dsb");
+}
+
 FASTRUN void FlexIO2VGA::ISR(void) {
   uint32_t timStatus = FLEXIO2_TIMSTAT & 0xFF;
   FLEXIO2_TIMSTAT = timStatus;
@@ -5,23 +5,82 @@
 #define _VGA_T4_CONFIG_H
 
 //===============================================
-// Uncomment the pair that represents the largest
-// screen dimensions you will need.
-// The larger the width and height dimensions the
-// less DMAMEM/malloc memory will be available.
+// Most frame buffers that can be used (1 to 3).
+// 1 = single buffer.
+// 2 = double buffering.
+// 3 = triple buffering (default).
+// See setBufferCount() and swapBuffers(). Extra
+// buffers are allocated when they are first used,
+// from the same memory as the first one, so this
+// only sizes a few pointer tables.
+//===============================================
+#define FB_COUNT 3
+//===============================================
+
+//===============================================
+// Bytes of RAM1 (DTCM) reserved for frame buffers
+// allocated with VGA_MEM_DTCM. 0 = none, then
+// begin() with VGA_MEM_DTCM always returns
+// VGA_ERR_MEMORY, so set this to use it.
+// A 640x480 4 bit buffer needs 481*336 bytes.
+//===============================================
+#define FB_DTCM_SIZE 0
+//===============================================
+
+//===============================================
+// Sustained DMA read rate of each memory in MB/s.
+// begin() compares these with the rate the mode
+// needs (pixel clock * bpp / 8) and returns
+// VGA_ERR_BANDWIDTH if the memory is too slow.
+// PSRAM is for the default 88MHz FlexSPI2 clock.
+//===============================================
+#define FB_DMAMEM_MBPS 200
+#define FB_DTCM_MBPS   300
+#define FB_PSRAM_MBPS  25
+//===============================================
+
+//===============================================
+// Size of the vblank job queue (see queueJob()).
+// Must be a power of 2.
+//===============================================
+#define VBLANK_JOBS 16
+//===============================================
+
+//===============================================
+// Size of the asynchronous DMA fill queue (see
+// fillRectAsync()). Must be a power of 2.
+//===============================================
+#define DMA_OPS 8
 //===============================================
 
-//#define MAX_WIDTH (1024/2)
-//#define MAX_HEIGHT 768
+//===============================================
+// Widest mode (in pixels) that line buffer scanout
+// (setLineBuffer()) is used with. Two 4 bit line
+// buffers of this width are kept in RAM1.
+//===============================================
+#define LINEBUF_WIDTH 1024
+//===============================================
 
-#define MAX_WIDTH (800/2)
-#define MAX_HEIGHT 600
+//===============================================
+// Most raster line callbacks that can be attached
+// (see attachRaster()).
+//===============================================
+#define RASTER_IRQS 8
+//===============================================
 
-//#define MAX_WIDTH (640/2)
-//#define MAX_HEIGHT 480
+//===============================================
+// Most clip rectangles that can be pushed at
+// once (see pushClipRect()).
+//===============================================
+#define CLIP_DEPTH 8
+//===============================================
 
-//#define MAX_WIDTH (640/2)
-//#define MAX_HEIGHT 400
+//===============================================
+// Polygons with up to this many points are filled
+// (fillPolygon()) with an edge table on the stack.
+// Bigger ones use malloc().
+//===============================================
+#define POLY_STACK_EDGES 32
 //===============================================
 
 #define TABSIZE 4
@@ -0,0 +1,124 @@
+//============================
+// blit.cpp
+//
+// Pixel copy within or between packed frame buffer rows.
+//============================
+#include <string.h>
+#include "blit.h"
+#include "nibble.h"
+
+static inline uint32_t load32(const uint8_t *p) {
+  uint32_t w;
+  memcpy(&w, p, 4);
+  return w;
+}
+
+static inline void store32(uint8_t *p, uint32_t w) {
+  memcpy(p, &w, 4);
+}
+
+//=======================================================
+// d[j] = s[j] shifted down one nibble, with the low
+// nibble of s[j+1] on top, for j = 0 to n-1. Goes
+// backwards when d is after s so overlap is safe.
+//=======================================================
+static void shift_nibble(uint8_t *d, const uint8_t *s, int n) {
+  int j;
+  if(d <= s) {
+    for(j = 0; (j + 4) <= n; j += 4)
+      store32(d + j, vga_nib_shift(load32(s + j), s[j+4]));
+    for(; j < n; j++) d[j] = (s[j] >> 4) | (s[j+1] << 4);
+  } else {
+    for(j = n; j & 3;) {
+      j--;
+      d[j] = (s[j] >> 4) | (s[j+1] << 4);
+    }
+    while(j > 0) {
+      j -= 4;
+      store32(d + j, vga_nib_shift(load32(s + j), s[j+4]));
+    }
+  }
+}
+
+//=======================================================
+// 4 bit row. A destination that starts on an odd pixel
+// or ends on an even one has a lone nibble at that end.
+// Both are read before and written after the middle so
+// overlap can't change them.
+//=======================================================
+void vga_copy_row4(uint8_t *dst, int dx, const uint8_t *src, int sx, int w) {
+  if(w <= 0) return;
+  int lead = dx & 1;
+  int tail = (dx + w) & 1;
+  uint8_t leadPix = 0;
+  uint8_t tailPix = 0;
+  if(lead) leadPix = (src[sx >> 1] >> ((sx & 1) << 2)) & 0x0f;
+  if(tail) {
+    int x = sx + w - 1;
+    tailPix = (src[x >> 1] >> ((x & 1) << 2)) & 0x0f;
+  }
+  int n = (w - lead - tail) / 2; // Whole destination bytes.
+  if(n > 0) {
+    uint8_t *d = dst + ((dx + lead) >> 1);
+    const uint8_t *s = src + ((sx + lead) >> 1);
+    if(((sx + lead) & 1) == 0) memmove(d, s, n);
+    else shift_nibble(d, s, n);
+  }
+  if(lead) {
+    uint8_t *p = &dst[dx >> 1];
+    *p = (*p & 0x0f) | (leadPix << 4);
+  }
+  if(tail) {
+    uint8_t *p = &dst[(dx + w - 1) >> 1];
+    *p = (*p & 0xf0) | tailPix;
+  }
+}
+
+//=======================================================
+// n bits (1 to 8) from bit position p, never reading
+// past the byte that holds the last one.
+//=======================================================
+static inline uint8_t get_bits(const uint8_t *s, int p, int n) {
+  uint32_t v = s[p >> 3] >> (p & 7);
+  if(((p & 7) + n) > 8) v |= s[(p >> 3) + 1] << (8 - (p & 7));
+  return v & (0xff >> (8 - n));
+}
+
+//=======================================================
+// 1 bit row, pixel x in bit (x & 7). Part bytes at each
+// end are handled like the 4 bit lone nibbles.
+//=======================================================
+void vga_copy_row1(uint8_t *dst, int dx, const uint8_t *src, int sx, int w) {
+  if(w <= 0) return;
+  int lead = (8 - (dx & 7)) & 7;  // Pixels before the first whole byte.
+  if(lead > w) lead = w;
+  int tail = (w - lead) & 7;      // Pixels after the last whole byte.
+  int n = (w - lead) >> 3;        // Whole destination bytes.
+  uint8_t leadBits = lead ? get_bits(src, sx, lead) : 0;
+  uint8_t tailBits = tail ? get_bits(src, sx + w - tail, tail) : 0;
+  if(n > 0) {
+    uint8_t *d = dst + ((dx + lead) >> 3);
+    int p = sx + lead;
+    int shift = p & 7;
+    const uint8_t *s = src + (p >> 3);
+    if(shift == 0) {
+      memmove(d, s, n);
+    } else if(d <= s) {
+      for(int j = 0; j < n; j++)
+        d[j] = (s[j] >> shift) | (s[j+1] << (8 - shift));
+    } else {
+      for(int j = n - 1; j >= 0; j--)
+        d[j] = (s[j] >> shift) | (s[j+1] << (8 - shift));
+    }
+  }
+  if(lead) {
+    uint8_t *q = &dst[dx >> 3];
+    uint8_t m = (0xff >> (8 - lead)) << (dx & 7);
+    *q = (*q & ~m) | ((leadBits << (dx & 7)) & m);
+  }
+  if(tail) {
+    uint8_t *q = &dst[(dx + w - tail) >> 3];
+    uint8_t m = 0xff >> (8 - tail);
+    *q = (*q & ~m) | (tailBits & m);
+  }
+}
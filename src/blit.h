@@ -0,0 +1,26 @@
+//============================
+// blit.h
+//
+// Pixel copy within or between packed frame buffer
+// rows, 4 or 1 bit per pixel. Source and destination
+// may overlap, the result is as if the source was read
+// first. When both start at the same pixel within a
+// byte the whole bytes are moved with memmove(),
+// otherwise they are shifted into place (4 bit rows 32
+// bits at a time). Part bytes at each end are merged in.
+// Callers copy rectangles row by row, bottom up when
+// the destination is below the source.
+// This file has no Teensy dependencies so it can also
+// be compiled on a host.
+//============================
+#ifndef _BLIT_H
+#define _BLIT_H
+
+#include <stdint.h>
+
+// Copy w pixels from pixel sx of row src to pixel dx
+// of row dst.
+void vga_copy_row4(uint8_t *dst, int dx, const uint8_t *src, int sx, int w);
+void vga_copy_row1(uint8_t *dst, int dx, const uint8_t *src, int sx, int w);
+
+#endif // _BLIT_H
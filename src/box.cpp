@@ -9,20 +9,20 @@
 // Save a rectanglar section of frame buffer memory to allocated memory.
 // The first 4 16bit locations hold  the coordinates (for vbox_put().
 uint8_t *vbox_get(int16_t row1, int16_t col1, int16_t row2, int16_t col2) {
-  int16_t width, height, tWidth, tHeight;
-  uint16_t bytes;
+  int16_t tWidth, tHeight;
+  int fw = vga4bit.getFontWidth();
+  int fh = vga4bit.getFontHeight();
+  uint32_t bytes;
   uint8_t *buf, *bufptr;
 
   // Keep in bounds of current character display.
   tHeight = vga4bit.getTheight();
   if(row2 >= tHeight) row2 = tHeight-1;
   tWidth = vga4bit.getTwidth();
-  if(col2 >= tWidth) row2 = tWidth-1;
+  if(col2 >= tWidth) col2 = tWidth-1;
   
   // calculate dimensions in bytes
-  width  = (col2 - col1) + 1;
-  height = (row2 - row1) + 1;
-  bytes  = (height * width) + 8;
+  bytes = vga4bit.rectBytes((col2 - col1 + 1) * fw, (row2 - row1 + 1) * fh) + 8;
 
   // allocate storage space
   if((buf = (uint8_t *)malloc(sizeof(uint8_t)*bytes)) == NULL) {
@@ -44,12 +44,9 @@ uint8_t *vbox_get(int16_t row1, int16_t col1, int16_t row2, int16_t col2) {
   *bufptr++ = (uint8_t)((col2 >> 8) & 0xff);
   *bufptr++ = (uint8_t)(col2 & 0xff);
 
-  // grab each line of video
-  for(uint16_t i = row1; i < row2; i++) {
-    for(uint16_t j = col1; j < col2+1; j++) {
-      vga4bit.getChar(j, i,bufptr);
-    }
-  }
+  // grab the whole box
+  vga4bit.saveRect(col1 * fw, row1 * fh, (col2 - col1 + 1) * fw,
+                   (row2 - row1 + 1) * fh, bufptr);
   return(buf);
 }
 
@@ -59,6 +56,8 @@ uint8_t *vbox_get(int16_t row1, int16_t col1, int16_t row2, int16_t col2) {
 //======================================================
 void vbox_put(uint8_t *buf) {
   int16_t row1, col1, row2, col2;
+  int fw = vga4bit.getFontWidth();
+  int fh = vga4bit.getFontHeight();
   uint8_t *workbuf;
 
   // get the coordinates back
@@ -71,12 +70,9 @@ void vbox_put(uint8_t *buf) {
   col2 = (uint16_t)((workbuf[6] << 8) + (workbuf[7] & 0xff));
   workbuf+=8; // Skip over coords to data.
 
-  // Write out each line of video
-  for(uint16_t i = row1; i < row2; i++) {
-    for(uint16_t j = col1; j < col2+1; j++) {
-      vga4bit.putChar(j, i, workbuf);
-    }
-  }
+  // Write back the whole box
+  vga4bit.restoreRect(col1 * fw, row1 * fh, (col2 - col1 + 1) * fw,
+                      (row2 - row1 + 1) * fh, workbuf);
 }
 
 //=======================================================
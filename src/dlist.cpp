@@ -0,0 +1,268 @@
+//============================
+// dlist.cpp
+//
+// Display list recording and replay.
+//============================
+#include <string.h>
+#include "dlist.h"
+
+// Recorded ops.
+enum {
+  DL_PIXEL = 1,
+  DL_LINE,
+  DL_RECT,
+  DL_FILL_RECT,
+  DL_CIRCLE,
+  DL_FILL_CIRCLE,
+  DL_ELLIPSE,
+  DL_FILL_ELLIPSE,
+  DL_TRIANGLE,
+  DL_FILL_TRIANGLE,
+  DL_RRECT,
+  DL_FILL_RRECT,
+  DL_TEXT,
+  DL_BITMAP
+};
+
+// Record header, followed by the arguments as int16_t.
+// Coordinates come first in (x,y) pairs so replay can move
+// them.
+typedef struct {
+  uint8_t op;
+  uint8_t color;
+  uint8_t bg;      // Text background.
+  uint8_t words;   // Record size in 4 byte words.
+  int16_t top;     // First and last rows drawn.
+  int16_t bottom;
+} dl_cmd;
+
+//=======================================================
+// Start an empty list.
+//=======================================================
+void vga_dl_init(vga_dlist_t *dl, void *buf, uint32_t size) {
+  dl->buf = (uint8_t *)buf;
+  dl->size = size & ~3;
+  vga_dl_clear(dl);
+}
+
+//=======================================================
+// Forget everything recorded.
+//=======================================================
+void vga_dl_clear(vga_dlist_t *dl) {
+  dl->used = 0;
+  dl->count = 0;
+}
+
+//=======================================================
+// Add a record with room for argBytes of arguments.
+// Returns the arguments, NULL if there is no room.
+//=======================================================
+static int16_t *dl_add(vga_dlist_t *dl, uint8_t op, uint8_t color, int top, int bottom,
+                       uint32_t argBytes) {
+  uint32_t bytes = (sizeof(dl_cmd) + argBytes + 3) & ~3;
+  if(((bytes / 4) > 255) || ((dl->used + bytes) > dl->size)) return NULL;
+  dl_cmd *c = (dl_cmd *)(dl->buf + dl->used);
+  c->op = op;
+  c->color = color;
+  c->bg = 0;
+  c->words = bytes / 4;
+  c->top = (top < bottom) ? top : bottom;
+  c->bottom = (top < bottom) ? bottom : top;
+  dl->used += bytes;
+  dl->count++;
+  return (int16_t *)(c + 1);
+}
+
+//=======================================================
+// Add a record of up to 6 int16_t arguments.
+//=======================================================
+static int dl_args(vga_dlist_t *dl, uint8_t op, uint8_t color, int top, int bottom,
+                   int n, int a0, int a1, int a2=0, int a3=0, int a4=0, int a5=0) {
+  int16_t *a = dl_add(dl, op, color, top, bottom, n * sizeof(int16_t));
+  if(a == NULL) return -1;
+  int v[6] = {a0, a1, a2, a3, a4, a5};
+  for(int i = 0; i < n; i++) a[i] = v[i];
+  return 0;
+}
+
+//=======================================================
+// Record calls.
+//=======================================================
+int vga_dl_pixel(vga_dlist_t *dl, int x, int y, uint8_t color) {
+  return dl_args(dl, DL_PIXEL, color, y, y, 2, x, y);
+}
+
+int vga_dl_line(vga_dlist_t *dl, int x0, int y0, int x1, int y1, uint8_t color) {
+  return dl_args(dl, DL_LINE, color, y0, y1, 4, x0, y0, x1, y1);
+}
+
+int vga_dl_rect(vga_dlist_t *dl, int x0, int y0, int x1, int y1, uint8_t color) {
+  return dl_args(dl, DL_RECT, color, y0, y1, 4, x0, y0, x1, y1);
+}
+
+int vga_dl_fill_rect(vga_dlist_t *dl, int x0, int y0, int x1, int y1, uint8_t color) {
+  return dl_args(dl, DL_FILL_RECT, color, y0, y1, 4, x0, y0, x1, y1);
+}
+
+int vga_dl_circle(vga_dlist_t *dl, int x, int y, int radius, int thickness, uint8_t color) {
+  int r = radius + thickness;
+  return dl_args(dl, DL_CIRCLE, color, y - r, y + r, 4, x, y, radius, thickness);
+}
+
+int vga_dl_fill_circle(vga_dlist_t *dl, int x, int y, int radius, uint8_t color) {
+  return dl_args(dl, DL_FILL_CIRCLE, color, y - radius, y + radius, 3, x, y, radius);
+}
+
+int vga_dl_ellipse(vga_dlist_t *dl, int cx, int cy, int radius1, int radius2, uint8_t color) {
+  return dl_args(dl, DL_ELLIPSE, color, cy - radius2, cy + radius2, 4, cx, cy, radius1, radius2);
+}
+
+int vga_dl_fill_ellipse(vga_dlist_t *dl, int cx, int cy, int radius1, int radius2, uint8_t color) {
+  return dl_args(dl, DL_FILL_ELLIPSE, color, cy - radius2, cy + radius2, 4, cx, cy, radius1, radius2);
+}
+
+int vga_dl_triangle(vga_dlist_t *dl, int x0, int y0, int x1, int y1, int x2, int y2, uint8_t color) {
+  int top = min(y0, min(y1, y2));
+  int bottom = max(y0, max(y1, y2));
+  return dl_args(dl, DL_TRIANGLE, color, top, bottom, 6, x0, y0, x1, y1, x2, y2);
+}
+
+int vga_dl_fill_triangle(vga_dlist_t *dl, int x0, int y0, int x1, int y1, int x2, int y2, uint8_t color) {
+  int top = min(y0, min(y1, y2));
+  int bottom = max(y0, max(y1, y2));
+  return dl_args(dl, DL_FILL_TRIANGLE, color, top, bottom, 6, x0, y0, x1, y1, x2, y2);
+}
+
+int vga_dl_rrect(vga_dlist_t *dl, int x0, int y0, int x1, int y1, int r, uint8_t color) {
+  return dl_args(dl, DL_RRECT, color, y0, y1, 5, x0, y0, x1, y1, r);
+}
+
+int vga_dl_fill_rrect(vga_dlist_t *dl, int x0, int y0, int x1, int y1, int r, uint8_t color) {
+  return dl_args(dl, DL_FILL_RRECT, color, y0, y1, 5, x0, y0, x1, y1, r);
+}
+
+int vga_dl_text(vga_dlist_t *dl, int x, int y, const char *text, uint8_t fgcolor, uint8_t bgcolor,
+                FlexIO2VGA &vga) {
+  uint32_t len = strlen(text) + 1;
+  int16_t *a = dl_add(dl, DL_TEXT, fgcolor, y, y + vga.getFontHeight() - 1, 2 * sizeof(int16_t) + len);
+  if(a == NULL) return -1;
+  ((dl_cmd *)a)[-1].bg = bgcolor;
+  a[0] = x;
+  a[1] = y;
+  memcpy(&a[2], text, len);
+  return 0;
+}
+
+int vga_dl_bitmap(vga_dlist_t *dl, int x, int y, uint8_t *bitmap, int w, int h) {
+  int16_t *a = dl_add(dl, DL_BITMAP, 0, y, y + h - 1, 4 * sizeof(int16_t) + sizeof(bitmap));
+  if(a == NULL) return -1;
+  a[0] = x;
+  a[1] = y;
+  a[2] = w;
+  a[3] = h;
+  memcpy(&a[4], &bitmap, sizeof(bitmap));
+  return 0;
+}
+
+//=======================================================
+// Run one record, moved by (dx,dy).
+//=======================================================
+static void dl_run(const dl_cmd *c, FlexIO2VGA &vga, int dx, int dy) {
+  const int16_t *a = (const int16_t *)(c + 1);
+  switch(c->op) {
+    case DL_PIXEL:
+      vga.drawPixel(a[0] + dx, a[1] + dy, c->color);
+      break;
+    case DL_LINE:
+      vga.drawLine(a[0] + dx, a[1] + dy, a[2] + dx, a[3] + dy, c->color, false);
+      break;
+    case DL_RECT:
+      vga.drawRect(a[0] + dx, a[1] + dy, a[2] + dx, a[3] + dy, c->color);
+      break;
+    case DL_FILL_RECT:
+      vga.fillRect(a[0] + dx, a[1] + dy, a[2] + dx, a[3] + dy, c->color);
+      break;
+    case DL_CIRCLE:
+      vga.drawCircle(a[0] + dx, a[1] + dy, a[2], a[3], c->color);
+      break;
+    case DL_FILL_CIRCLE:
+      vga.fillCircle(a[0] + dx, a[1] + dy, a[2], c->color);
+      break;
+    case DL_ELLIPSE:
+      vga.drawEllipse(a[0] + dx, a[1] + dy, a[2], a[3], c->color);
+      break;
+    case DL_FILL_ELLIPSE:
+      vga.fillEllipse(a[0] + dx, a[1] + dy, a[2], a[3], c->color);
+      break;
+    case DL_TRIANGLE:
+      vga.drawTriangle(a[0] + dx, a[1] + dy, a[2] + dx, a[3] + dy, a[4] + dx, a[5] + dy, c->color);
+      break;
+    case DL_FILL_TRIANGLE:
+      vga.fillTriangle(a[0] + dx, a[1] + dy, a[2] + dx, a[3] + dy, a[4] + dx, a[5] + dy, c->color);
+      break;
+    case DL_RRECT:
+      vga.drawRrect(a[0] + dx, a[1] + dy, a[2] + dx, a[3] + dy, a[4], c->color);
+      break;
+    case DL_FILL_RRECT:
+      vga.fillRrect(a[0] + dx, a[1] + dy, a[2] + dx, a[3] + dy, a[4], c->color);
+      break;
+    case DL_TEXT:
+      vga.drawText(a[0] + dx, a[1] + dy, (const char *)&a[2], c->color, c->bg);
+      break;
+    case DL_BITMAP: {
+      uint8_t *bitmap;
+      memcpy(&bitmap, &a[4], sizeof(bitmap));
+      vga.drawBitmap(a[0] + dx, a[1] + dy, bitmap, a[2], a[3]);
+      break;
+    }
+  }
+}
+
+//=======================================================
+// Replay in recorded order.
+//=======================================================
+void vga_dl_play(const vga_dlist_t *dl, FlexIO2VGA &vga, int dx, int dy) {
+  for(uint32_t off = 0; off < dl->used; ) {
+    const dl_cmd *c = (const dl_cmd *)(dl->buf + off);
+    dl_run(c, vga, dx, dy);
+    off += c->words * 4;
+  }
+}
+
+//=======================================================
+// Replay a band at a time. The records are scanned once
+// per band and those whose rows reach it are run, in
+// recorded order so overlaps come out the same as
+// vga_dl_play(). Every call clips per pixel without
+// moving what it draws, so the bands join up exactly.
+//=======================================================
+void vga_dl_play_bands(const vga_dlist_t *dl, FlexIO2VGA &vga, int dx, int dy, int rows) {
+  int x0, y0, x1, y1;
+  if((dl->used == 0) || !vga.getClipRect(&x0, &y0, &x1, &y1)) return;
+  if(rows <= 0) rows = VGA_DL_BAND_ROWS;
+  // Only the rows something is drawn in.
+  int top = y1;
+  int bottom = y0;
+  for(uint32_t off = 0; off < dl->used; ) {
+    const dl_cmd *c = (const dl_cmd *)(dl->buf + off);
+    top = min(top, c->top + dy);
+    bottom = max(bottom, c->bottom + dy);
+    off += c->words * 4;
+  }
+  top = max(top, y0);
+  bottom = min(bottom, y1);
+  for(int y = top; y <= bottom; y += rows) {
+    int end = min(y + rows - 1, bottom);
+    if(vga.pushClipRect(x0, y, x1, end) < 0) {
+      // Clip stack full, no banding.
+      vga_dl_play(dl, vga, dx, dy);
+      return;
+    }
+    for(uint32_t off = 0; off < dl->used; ) {
+      const dl_cmd *c = (const dl_cmd *)(dl->buf + off);
+      if(((c->bottom + dy) >= y) && ((c->top + dy) <= end)) dl_run(c, vga, dx, dy);
+      off += c->words * 4;
+    }
+    vga.popClipRect();
+  }
+}
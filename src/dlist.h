@@ -0,0 +1,66 @@
+//============================
+// dlist.h
+//
+// Display lists. Drawing calls are recorded into a caller
+// supplied arena and replayed later onto any FlexIO2VGA,
+// moved by an offset. Replay can also go a band of rows at
+// a time, so each band of the frame buffer is drawn in one
+// go while it is in cache.
+// Good for screen furniture (desktops, frames, gauge dials)
+// that has to be redrawn after a mode change or when part of
+// the screen has been overwritten.
+//============================
+#ifndef _DLIST_H
+#define _DLIST_H
+
+#include "VGA_4bit_T4.h"
+
+// Rows per band for vga_dl_play_bands().
+#define VGA_DL_BAND_ROWS 32
+
+// A display list. Records are 4 byte aligned, each a small
+// header (op, colors, rows drawn) then its arguments.
+typedef struct {
+  uint8_t  *buf;   // Arena, 4 byte aligned.
+  uint32_t size;   // Arena bytes.
+  uint32_t used;   // Bytes recorded.
+  uint16_t count;  // Calls recorded.
+} vga_dlist_t;
+
+// Start an empty list in buf.
+void vga_dl_init(vga_dlist_t *dl, void *buf, uint32_t size);
+// Forget everything recorded.
+void vga_dl_clear(vga_dlist_t *dl);
+
+// Record a call, arguments are the same as the FlexIO2VGA
+// method's. Return -1 if the arena is full.
+int vga_dl_pixel(vga_dlist_t *dl, int x, int y, uint8_t color);
+int vga_dl_line(vga_dlist_t *dl, int x0, int y0, int x1, int y1, uint8_t color);
+int vga_dl_rect(vga_dlist_t *dl, int x0, int y0, int x1, int y1, uint8_t color);
+int vga_dl_fill_rect(vga_dlist_t *dl, int x0, int y0, int x1, int y1, uint8_t color);
+int vga_dl_circle(vga_dlist_t *dl, int x, int y, int radius, int thickness, uint8_t color);
+int vga_dl_fill_circle(vga_dlist_t *dl, int x, int y, int radius, uint8_t color);
+int vga_dl_ellipse(vga_dlist_t *dl, int cx, int cy, int radius1, int radius2, uint8_t color);
+int vga_dl_fill_ellipse(vga_dlist_t *dl, int cx, int cy, int radius1, int radius2, uint8_t color);
+int vga_dl_triangle(vga_dlist_t *dl, int x0, int y0, int x1, int y1, int x2, int y2, uint8_t color);
+int vga_dl_fill_triangle(vga_dlist_t *dl, int x0, int y0, int x1, int y1, int x2, int y2, uint8_t color);
+int vga_dl_rrect(vga_dlist_t *dl, int x0, int y0, int x1, int y1, int r, uint8_t color);
+int vga_dl_fill_rrect(vga_dlist_t *dl, int x0, int y0, int x1, int y1, int r, uint8_t color);
+// The text is copied into the list (up to 1000 characters).
+// Its rows come from the font vga has when it is recorded,
+// replay with the same font size.
+int vga_dl_text(vga_dlist_t *dl, int x, int y, const char *text, uint8_t fgcolor, uint8_t bgcolor,
+                FlexIO2VGA &vga);
+// The bitmap is not copied, it must still be there at replay.
+int vga_dl_bitmap(vga_dlist_t *dl, int x, int y, uint8_t *bitmap, int w, int h);
+
+// Replay in recorded order, moved by (dx,dy).
+void vga_dl_play(const vga_dlist_t *dl, FlexIO2VGA &vga, int dx=0, int dy=0);
+// Replay a band of rows at a time, each band clipped with
+// pushClipRect(). A call is run again in every band its
+// rows reach, only the part inside the band is drawn. The
+// result is the same as vga_dl_play().
+void vga_dl_play_bands(const vga_dlist_t *dl, FlexIO2VGA &vga, int dx=0, int dy=0,
+                       int rows=VGA_DL_BAND_ROWS);
+
+#endif // _DLIST_H
@@ -0,0 +1,116 @@
+//============================
+// fixtrig.cpp
+//
+// Fixed point sine, cosine and 2D affine transforms.
+//============================
+#include "fixtrig.h"
+
+//=======================================================
+// Compile time sine for building the table, Taylor series
+// for 0 <= x <= pi / 2.
+//=======================================================
+static constexpr double ct_sin(double x) {
+  double term = x;
+  double sum = x;
+  for(int n = 1; n < 12; n++) {
+    term *= -(x * x) / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+// Quarter wave, sin(i * 90 / VGA_SIN_STEPS degrees) in Q15.
+// The last entry is 1.0 (32768), hence uint16_t.
+struct sin_table {
+  uint16_t v[VGA_SIN_STEPS + 1];
+  constexpr sin_table() : v() {
+    for(int i = 0; i <= VGA_SIN_STEPS; i++)
+      v[i] = (uint16_t)(ct_sin(i * (3.14159265358979324 / 2) / VGA_SIN_STEPS) * VGA_Q15_ONE + 0.5);
+  }
+};
+static constexpr sin_table sinTable;
+
+// Angle bits below a table index.
+#define SIN_FRAC_BITS (14 - VGA_SIN_BITS)
+
+//=======================================================
+// Degrees to a binary angle.
+//=======================================================
+vga_angle_t vga_deg(int32_t deg) {
+  deg %= 360;
+  if(deg < 0) deg += 360;
+  return (vga_angle_t)((deg * VGA_ANGLE_TURN + 180) / 360);
+}
+
+//=======================================================
+// Q16 degrees to a binary angle.
+//=======================================================
+vga_angle_t vga_deg_q16(int32_t deg) {
+  const int64_t turn = 360LL << 16;
+  int64_t d = deg % turn;
+  if(d < 0) d += turn;
+  return (vga_angle_t)((d * VGA_ANGLE_TURN + turn / 2) / turn);
+}
+
+//=======================================================
+// Q15 sine. The top two angle bits are the quadrant, the
+// rest index the quarter wave (mirrored in the second and
+// fourth quadrants) with the low bits interpolated.
+//=======================================================
+int32_t vga_sin(vga_angle_t a) {
+  uint32_t i = a & 0x3fff;
+  if(a & 0x4000) i = 0x4000 - i;
+  uint32_t n = i >> SIN_FRAC_BITS;
+  uint32_t f = i & ((1 << SIN_FRAC_BITS) - 1);
+  int32_t v = sinTable.v[n];
+  if(f) v += ((sinTable.v[n + 1] - v) * (int32_t)f + (1 << (SIN_FRAC_BITS - 1))) >> SIN_FRAC_BITS;
+  return (a & 0x8000) ? -v : v;
+}
+
+//=======================================================
+// Affine transforms.
+//=======================================================
+void vga_affine_identity(vga_affine_t *m) {
+  m->a = VGA_Q16_ONE;
+  m->b = 0;
+  m->c = 0;
+  m->d = VGA_Q16_ONE;
+  m->tx = 0;
+  m->ty = 0;
+}
+
+void vga_affine_rotate(vga_affine_t *m, vga_angle_t angle) {
+  int32_t s = vga_sin(angle) * 2; // Q15 to Q16
+  int32_t c = vga_cos(angle) * 2;
+  m->a = c;
+  m->b = -s;
+  m->c = s;
+  m->d = c;
+  m->tx = 0;
+  m->ty = 0;
+}
+
+void vga_affine_scale(vga_affine_t *m, int32_t sx, int32_t sy) {
+  m->a = sx;
+  m->b = 0;
+  m->c = 0;
+  m->d = sy;
+  m->tx = 0;
+  m->ty = 0;
+}
+
+void vga_affine_translate(vga_affine_t *m, int32_t dx, int32_t dy) {
+  m->tx += dx;
+  m->ty += dy;
+}
+
+void vga_affine_mul(vga_affine_t *r, const vga_affine_t *m1, const vga_affine_t *m2) {
+  vga_affine_t t;
+  t.a = (int32_t)(((int64_t)m1->a * m2->a + (int64_t)m1->b * m2->c + 0x8000) >> 16);
+  t.b = (int32_t)(((int64_t)m1->a * m2->b + (int64_t)m1->b * m2->d + 0x8000) >> 16);
+  t.c = (int32_t)(((int64_t)m1->c * m2->a + (int64_t)m1->d * m2->c + 0x8000) >> 16);
+  t.d = (int32_t)(((int64_t)m1->c * m2->b + (int64_t)m1->d * m2->d + 0x8000) >> 16);
+  t.tx = (int32_t)(((int64_t)m1->a * m2->tx + (int64_t)m1->b * m2->ty + 0x8000) >> 16) + m1->tx;
+  t.ty = (int32_t)(((int64_t)m1->c * m2->tx + (int64_t)m1->d * m2->ty + 0x8000) >> 16) + m1->ty;
+  *r = t;
+}
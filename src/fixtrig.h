@@ -0,0 +1,70 @@
+//============================
+// fixtrig.h
+//
+// Fixed point sine and cosine, and 2D affine transforms
+// for rotating shapes without floating point.
+// Angles are binary, a full turn is 65536, so they wrap
+// for free in a uint16_t. Sine and cosine are Q15 (32768
+// is 1.0) from a quarter wave table built at compile
+// time, interpolated between entries.
+// This file has no Teensy dependencies so it can also
+// be compiled on a host.
+//============================
+#ifndef _FIXTRIG_H
+#define _FIXTRIG_H
+
+#include <stdint.h>
+
+// Binary angle, 65536 to a full turn.
+typedef uint16_t vga_angle_t;
+
+#define VGA_ANGLE_TURN 65536
+#define VGA_Q15_ONE    32768
+#define VGA_Q16_ONE    65536
+
+// Quarter wave table entries, a power of 2. The angle bits
+// below the index are used to interpolate.
+#define VGA_SIN_BITS  8
+#define VGA_SIN_STEPS (1 << VGA_SIN_BITS)
+
+// Degrees to a binary angle, any number of turns.
+vga_angle_t vga_deg(int32_t deg);
+// Degrees in Q16 (65536 is 1 degree) to a binary angle.
+vga_angle_t vga_deg_q16(int32_t deg);
+
+// Q15 sine and cosine, -32768 to 32768. The error is
+// under 2 / 32768.
+int32_t vga_sin(vga_angle_t a);
+static inline int32_t vga_cos(vga_angle_t a) {
+  return vga_sin((vga_angle_t)(a + VGA_ANGLE_TURN / 4));
+}
+
+// 2D affine transform, Q16 except for the translation:
+//   x' = (a * x + b * y) / 65536 + tx
+//   y' = (c * x + d * y) / 65536 + ty
+// Screen y goes down, so a positive rotation turns
+// clockwise on screen.
+typedef struct {
+  int32_t a, b;
+  int32_t c, d;
+  int32_t tx, ty;
+} vga_affine_t;
+
+void vga_affine_identity(vga_affine_t *m);
+// Rotation by angle about (0,0).
+void vga_affine_rotate(vga_affine_t *m, vga_angle_t angle);
+// Scale by sx, sy (Q16) about (0,0).
+void vga_affine_scale(vga_affine_t *m, int32_t sx, int32_t sy);
+// Move by (dx,dy) after the transform.
+void vga_affine_translate(vga_affine_t *m, int32_t dx, int32_t dy);
+// r = first m2 then m1. r may be m1 or m2.
+void vga_affine_mul(vga_affine_t *r, const vga_affine_t *m1, const vga_affine_t *m2);
+
+// Transform a point, rounded to the nearest pixel.
+static inline void vga_affine_apply(const vga_affine_t *m, int32_t x, int32_t y,
+                                    int32_t *ox, int32_t *oy) {
+  *ox = (int32_t)((((int64_t)m->a * x + (int64_t)m->b * y) + 0x8000) >> 16) + m->tx;
+  *oy = (int32_t)((((int64_t)m->c * x + (int64_t)m->d * y) + 0x8000) >> 16) + m->ty;
+}
+
+#endif // _FIXTRIG_H
@@ -0,0 +1,257 @@
+//============================
+// image.cpp
+//
+// Streaming BMP and PCX decoder.
+//============================
+#include <string.h>
+#include "image.h"
+
+//=======================================================
+// Nearest of the 16 colors. Each of red, green and blue
+// is 2/3 on from its own bit, and intensity adds 1/3 to
+// all three.
+//=======================================================
+uint8_t vga_rgbi(uint8_t r, uint8_t g, uint8_t b) {
+  uint8_t best = 0;
+  int32_t bestErr = 0x7fffffff;
+  for(int c = 0; c < 16; c++) {
+    int i = (c & 8) ? 0x55 : 0;
+    int dr = r - (((c & 4) ? 0xaa : 0) + i);
+    int dg = g - (((c & 2) ? 0xaa : 0) + i);
+    int db = b - (((c & 1) ? 0xaa : 0) + i);
+    int32_t err = dr * dr + dg * dg + db * db;
+    if(err < bestErr) {
+      bestErr = err;
+      best = c;
+    }
+  }
+  return best;
+}
+
+//=======================================================
+// Next byte of the file, -1 at the end.
+//=======================================================
+static int img_byte(vga_img_t *img) {
+  if(img->next >= img->len) {
+    int n = img->rd.read(img->rd.ctx, img->chunk, VGA_IMG_CHUNK);
+    if(n <= 0) return -1;
+    img->len = n;
+    img->next = 0;
+  }
+  img->pos++;
+  return img->chunk[img->next++];
+}
+
+//=======================================================
+// Next n bytes of the file (to buf if not NULL). Returns
+// -1 if the file ends first.
+//=======================================================
+static int img_bytes(vga_img_t *img, uint8_t *buf, uint32_t n) {
+  while(n > 0) {
+    if(img->next >= img->len) {
+      int c = img_byte(img); // Refill.
+      if(c < 0) return -1;
+      if(buf) *buf++ = c;
+      n--;
+      continue;
+    }
+    uint32_t k = img->len - img->next;
+    if(k > n) k = n;
+    if(buf) {
+      memcpy(buf, &img->chunk[img->next], k);
+      buf += k;
+    }
+    img->next += k;
+    img->pos += k;
+    n -= k;
+  }
+  return 0;
+}
+
+//=======================================================
+// Go to byte pos of the file.
+//=======================================================
+static int img_seek(vga_img_t *img, uint32_t pos) {
+  if((img->rd.seek == NULL) || (img->rd.seek(img->rd.ctx, pos) < 0)) return -1;
+  img->len = 0;
+  img->next = 0;
+  img->pos = pos;
+  return 0;
+}
+
+static inline uint16_t le16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t le32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+//=======================================================
+// BMP header and palette, after the "BM". Only the 40
+// byte (and longer) info header, uncompressed.
+//=======================================================
+static int bmp_open(vga_img_t *img) {
+  uint8_t h[52];
+  // Rest of the file header, then the info header.
+  if(img_bytes(img, h, 52) < 0) return -1;
+  uint32_t dataPos = le32(&h[8]);
+  uint32_t infoSize = le32(&h[12]);
+  int32_t w = (int32_t)le32(&h[16]);
+  int32_t ht = (int32_t)le32(&h[20]);
+  uint16_t bits = le16(&h[26]);
+  uint32_t colors = le32(&h[44]);
+  if((infoSize < 40) || (le32(&h[28]) != 0)) return -1; // Compressed.
+  if(((bits != 4) && (bits != 8)) || (w <= 0) || (w > VGA_IMG_MAX_W) || (ht == 0)) return -1;
+  if(img_bytes(img, NULL, infoSize - 40) < 0) return -1;
+  if((colors == 0) || (colors > (1U << bits))) colors = 1 << bits;
+  memset(img->lut, 0, sizeof(img->lut));
+  for(uint32_t i = 0; i < colors; i++) {
+    uint8_t q[4]; // Blue, green, red, unused.
+    if(img_bytes(img, q, 4) < 0) return -1;
+    img->lut[i] = vga_rgbi(q[2], q[1], q[0]);
+  }
+  if(dataPos < img->pos) return -1;
+  if(img_bytes(img, NULL, dataPos - img->pos) < 0) return -1;
+  img->format = VGA_IMG_BMP;
+  img->bits = bits;
+  img->w = w;
+  img->topDown = ht < 0;
+  img->h = (ht < 0) ? -ht : ht;
+  img->lineBytes = ((w * bits + 31) / 32) * 4;
+  return 0;
+}
+
+//=======================================================
+// PCX header and palette, after the first byte. The 8
+// bit palette is the last 769 bytes of the file (0x0c
+// then 256 RGB triples).
+//=======================================================
+static int pcx_open(vga_img_t *img) {
+  uint8_t h[127];
+  if(img_bytes(img, h, 127) < 0) return -1;
+  // h[n] is header byte n + 1.
+  uint8_t bits = h[2];
+  int w = le16(&h[7]) - le16(&h[3]) + 1;
+  int ht = le16(&h[9]) - le16(&h[5]) + 1;
+  uint8_t planes = h[64];
+  uint16_t lineBytes = le16(&h[65]);
+  if((h[1] != 1) || (w <= 0) || (w > VGA_IMG_MAX_W) || (ht <= 0)) return -1;
+  if((planes * lineBytes) > (int)sizeof(img->line)) return -1;
+  memset(img->lut, 0, sizeof(img->lut));
+  if((bits == 8) && (planes == 1)) {
+    uint8_t pal[3];
+    if((img->rd.size < (128 + 769)) || (img_seek(img, img->rd.size - 769) < 0)) return -1;
+    if(img_byte(img) != 0x0c) return -1;
+    for(int i = 0; i < 256; i++) {
+      if(img_bytes(img, pal, 3) < 0) return -1;
+      img->lut[i] = vga_rgbi(pal[0], pal[1], pal[2]);
+    }
+    if(img_seek(img, 128) < 0) return -1;
+  } else if(((bits == 4) && (planes == 1)) || ((bits == 1) && (planes == 4))) {
+    // 16 color palette in the header.
+    for(int i = 0; i < 16; i++)
+      img->lut[i] = vga_rgbi(h[15 + i * 3], h[16 + i * 3], h[17 + i * 3]);
+    bits = 4;
+  } else {
+    return -1;
+  }
+  img->format = VGA_IMG_PCX;
+  img->bits = bits;
+  img->w = w;
+  img->h = ht;
+  img->planes = planes;
+  img->lineBytes = lineBytes;
+  img->run = 0;
+  return 0;
+}
+
+//=======================================================
+// Read the header.
+//=======================================================
+int vga_img_open(vga_img_t *img, const vga_img_reader_t *rd) {
+  img->rd = *rd;
+  img->pos = 0;
+  img->len = 0;
+  img->next = 0;
+  int c = img_byte(img);
+  if(c == 0x0a) return pcx_open(img);
+  if((c == 'B') && (img_byte(img) == 'M')) return bmp_open(img);
+  return -1;
+}
+
+//=======================================================
+// BMP rows, packed pixels with the first in the high
+// nibble, each row padded to 4 bytes.
+//=======================================================
+static int bmp_rows(vga_img_t *img, vga_img_row_t row, void *ctx) {
+  for(int i = 0; i < img->h; i++) {
+    if(img_bytes(img, img->line, img->lineBytes) < 0) return -1;
+    if(img->bits == 8) {
+      for(int x = 0; x < img->w; x++) img->row[x] = img->lut[img->line[x]];
+    } else {
+      for(int x = 0; x < img->w; x++)
+        img->row[x] = img->lut[(img->line[x >> 1] >> ((x & 1) ? 0 : 4)) & 0x0f];
+    }
+    row(ctx, img->topDown ? i : img->h - 1 - i, img->row, img->w);
+  }
+  return 0;
+}
+
+//=======================================================
+// PCX rows. Each row is run length encoded, a byte of
+// 0xc0 + count then the value, or a single value below
+// 0xc0. Some writers let runs cross rows so the run is
+// kept between them.
+//=======================================================
+static int pcx_rows(vga_img_t *img, vga_img_row_t row, void *ctx) {
+  int n = img->planes * img->lineBytes;
+  int bpl = img->lineBytes;
+  for(int y = 0; y < img->h; y++) {
+    for(int i = 0; i < n; i++) {
+      if(img->run == 0) {
+        int c = img_byte(img);
+        if(c < 0) return -1;
+        if(c >= 0xc0) {
+          img->run = c & 0x3f;
+          c = img_byte(img);
+          if(c < 0) return -1;
+          if(img->run == 0) {
+            i--; // Empty run.
+            continue;
+          }
+        } else {
+          img->run = 1;
+        }
+        img->runValue = c;
+      }
+      img->line[i] = img->runValue;
+      img->run--;
+    }
+    if(img->planes == 4) {
+      // Bit planes, first pixel in the top bit.
+      for(int x = 0; x < img->w; x++) {
+        int sh = 7 - (x & 7);
+        const uint8_t *p = &img->line[x >> 3];
+        uint8_t c = ((p[0] >> sh) & 1) | (((p[bpl] >> sh) & 1) << 1) |
+                    (((p[2 * bpl] >> sh) & 1) << 2) | (((p[3 * bpl] >> sh) & 1) << 3);
+        img->row[x] = img->lut[c];
+      }
+    } else if(img->bits == 8) {
+      for(int x = 0; x < img->w; x++) img->row[x] = img->lut[img->line[x]];
+    } else {
+      for(int x = 0; x < img->w; x++)
+        img->row[x] = img->lut[(img->line[x >> 1] >> ((x & 1) ? 0 : 4)) & 0x0f];
+    }
+    row(ctx, y, img->row, img->w);
+  }
+  return 0;
+}
+
+//=======================================================
+// Decode the rows.
+//=======================================================
+int vga_img_rows(vga_img_t *img, vga_img_row_t row, void *ctx) {
+  if(img->format == VGA_IMG_PCX) return pcx_rows(img, row, ctx);
+  return bmp_rows(img, row, ctx);
+}
@@ -0,0 +1,87 @@
+//============================
+// image.h
+//
+// Streaming BMP and PCX decoder, 4 and 8 bits per pixel.
+// The file is read a small chunk at a time through a
+// reader and handed over a row at a time, already in RGBI
+// colors, to a row callback. The palette is converted to
+// RGBI once, into a lookup table, so each pixel is a table
+// lookup. Only one row is held, never the whole image.
+// BMP rows are handed over in file order, bottom up for
+// most files, so they can go straight to the frame buffer.
+// This file has no Teensy dependencies so it can also
+// be compiled on a host, e.g. with a reader on fread().
+// See imagefile.h for Arduino Stream and File readers.
+//============================
+#ifndef _IMAGE_H
+#define _IMAGE_H
+
+#include <stdint.h>
+
+// Widest image that can be decoded.
+#ifndef VGA_IMG_MAX_W
+#define VGA_IMG_MAX_W 1024
+#endif
+
+// Bytes read from the source at a time.
+#define VGA_IMG_CHUNK 256
+
+// Image formats.
+#define VGA_IMG_BMP 0
+#define VGA_IMG_PCX 1
+
+// Where the file comes from.
+typedef struct {
+  // Read up to n bytes into buf. Returns the bytes read, 0
+  // at the end.
+  int (*read)(void *ctx, uint8_t *buf, int n);
+  // Go to byte pos of the file. Returns 0, or -1 if it
+  // can't. NULL if the source can't seek.
+  int (*seek)(void *ctx, uint32_t pos);
+  void *ctx;
+  uint32_t size;  // File bytes, 0 if not known.
+} vga_img_reader_t;
+
+// Row y (0 is the top) of the image, w pixels, one RGBI
+// color per byte.
+typedef void (*vga_img_row_t)(void *ctx, int y, const uint8_t *pixels, int w);
+
+// An image being decoded.
+typedef struct {
+  int16_t w;              // Size in pixels.
+  int16_t h;
+  uint8_t format;         // VGA_IMG_BMP or VGA_IMG_PCX.
+  uint8_t bits;           // Bits per pixel, 4 or 8.
+  // Decoder state.
+  vga_img_reader_t rd;
+  uint32_t pos;           // Bytes used from the file.
+  uint16_t len;           // Bytes in chunk.
+  uint16_t next;          // Next byte of chunk.
+  bool topDown;           // BMP rows are top first.
+  uint8_t planes;         // PCX bit planes.
+  uint16_t lineBytes;     // Bytes per row (BMP) or plane (PCX).
+  uint8_t run;            // PCX run bytes still to come.
+  uint8_t runValue;
+  uint8_t lut[256];       // Palette index to RGBI.
+  uint8_t chunk[VGA_IMG_CHUNK];
+  uint8_t line[VGA_IMG_MAX_W + 4]; // Encoded row.
+  uint8_t row[VGA_IMG_MAX_W];      // Decoded row.
+} vga_img_t;
+
+// Nearest RGBI color (VGA_BLACK to VGA_BRIGHT_WHITE) to
+// an RGB color.
+uint8_t vga_rgbi(uint8_t r, uint8_t g, uint8_t b);
+
+// Read the header and palette, leaving img->w and img->h
+// set. Returns -1 if the file is not a BMP (uncompressed,
+// 4 or 8 bit) or PCX (8 bit, 4 bit or 4 planes of 1 bit)
+// image, or is wider than VGA_IMG_MAX_W. 8 bit PCX files
+// have the palette at the end, the reader must be able to
+// seek and know the file size.
+int vga_img_open(vga_img_t *img, const vga_img_reader_t *rd);
+
+// Decode the rows, calling row for each one. Returns -1 if
+// the file ends early.
+int vga_img_rows(vga_img_t *img, vga_img_row_t row, void *ctx);
+
+#endif // _IMAGE_H
@@ -0,0 +1,40 @@
+//============================
+// imagefile.cpp
+//
+// Image decoder readers for Streams and Files.
+//============================
+#include "imagefile.h"
+
+static int stream_read(void *ctx, uint8_t *buf, int n) {
+  return ((Stream *)ctx)->readBytes((char *)buf, n);
+}
+
+static int file_read(void *ctx, uint8_t *buf, int n) {
+  int got = ((File *)ctx)->read(buf, n);
+  return (got < 0) ? 0 : got;
+}
+
+static int file_seek(void *ctx, uint32_t pos) {
+  return ((File *)ctx)->seek(pos) ? 0 : -1;
+}
+
+//=======================================================
+// Stream reader.
+//=======================================================
+void vga_img_stream(vga_img_reader_t *rd, Stream *s) {
+  rd->read = stream_read;
+  rd->seek = NULL;
+  rd->ctx = s;
+  rd->size = 0;
+}
+
+//=======================================================
+// File reader.
+//=======================================================
+void vga_img_file(vga_img_reader_t *rd, File *f) {
+  f->seek(0);
+  rd->read = file_read;
+  rd->seek = file_seek;
+  rd->ctx = f;
+  rd->size = f->size();
+}
@@ -0,0 +1,20 @@
+//============================
+// imagefile.h
+//
+// Readers for the image decoder (image.h) on Arduino
+// Streams (serial, network) and Files (SD, LittleFS).
+//============================
+#ifndef _IMAGEFILE_H
+#define _IMAGEFILE_H
+
+#include "Arduino.h"
+#include <FS.h>
+#include "image.h"
+
+// Read from a Stream. It can't seek, so 8 bit PCX files
+// can't be read this way.
+void vga_img_stream(vga_img_reader_t *rd, Stream *s);
+// Read from an open File, from its start.
+void vga_img_file(vga_img_reader_t *rd, File *f);
+
+#endif // _IMAGEFILE_H
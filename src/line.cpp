@@ -0,0 +1,289 @@
+//============================
+// line.cpp
+//
+// Line drawing for packed frame buffers.
+//============================
+#include <stddef.h>
+#include "line.h"
+#include "span.h"
+
+// A line set up for stepping from pixel first.
+typedef struct {
+  int d, e;      // Longer and shorter axis deltas (d >= e).
+  bool xMajor;   // x is the longer axis.
+  int sx;        // x step, +1 or -1.
+  int sy;        // y step, +1 or -1.
+  int x, y;      // Pixel first.
+  int32_t err;   // Error term at pixel first.
+  int n;         // Pixels to draw.
+} line_walk;
+
+//=======================================================
+// Set up w for pixels first to last. Returns false if
+// there are none.
+//=======================================================
+static bool line_start(line_walk *w, int x0, int y0, int x1, int y1, int first, int last) {
+  int dx = x1 - x0;
+  int dy = y1 - y0;
+  w->sx = 1;
+  w->sy = 1;
+  if(dx < 0) {
+    dx = -dx;
+    w->sx = -1;
+  }
+  if(dy < 0) {
+    dy = -dy;
+    w->sy = -1;
+  }
+  w->xMajor = dx >= dy;
+  w->d = w->xMajor ? dx : dy;
+  w->e = w->xMajor ? dy : dx;
+  if(first < 0) first = 0;
+  if(last > w->d) last = w->d;
+  if(first > last) return false;
+  int m = (w->d > 0) ? vga_line_minor(first, w->d, w->e) : 0;
+  w->err = vga_line_err(first, m, w->d, w->e);
+  w->x = x0 + w->sx * (w->xMajor ? first : m);
+  w->y = y0 + w->sy * (w->xMajor ? m : first);
+  w->n = last - first + 1;
+  return true;
+}
+
+//=======================================================
+// 4 bit line. p and shift follow the pixel, shift is 4
+// for an odd pixel (high nibble).
+//=======================================================
+void vga_line4(uint8_t *fb, int32_t pitch, int x0, int y0, int x1, int y1,
+               uint8_t color, int first, int last) {
+  line_walk w;
+  if(!line_start(&w, x0, y0, x1, y1, first, last)) return;
+  int32_t sy = w.sy * pitch;
+  int d2 = 2 * w.d;
+  int e2 = 2 * w.e;
+  int32_t err = w.err;
+  int n = w.n;
+  uint8_t *p = fb + w.y * pitch + (w.x >> 1);
+  int shift = (w.x & 1) << 2;
+  color &= 0x0f;
+  if(w.xMajor) {
+    // x major, one pixel per column.
+    while(n-- > 0) {
+      *p = (*p & ~(0x0f << shift)) | (color << shift);
+      if(err > 0) {
+        p += sy;
+        err -= d2;
+      }
+      err += e2;
+      if(w.sx > 0) {
+        p += shift >> 2;
+        shift ^= 4;
+      } else {
+        shift ^= 4;
+        p -= shift >> 2;
+      }
+    }
+  } else {
+    // y major, one pixel per row.
+    while(n-- > 0) {
+      *p = (*p & ~(0x0f << shift)) | (color << shift);
+      if(err > 0) {
+        if(w.sx > 0) {
+          p += shift >> 2;
+          shift ^= 4;
+        } else {
+          shift ^= 4;
+          p -= shift >> 2;
+        }
+        err -= d2;
+      }
+      err += e2;
+      p += sy;
+    }
+  }
+}
+
+//=======================================================
+// 1 bit line. p and bit follow the pixel.
+//=======================================================
+void vga_line1(uint8_t *fb, int32_t pitch, int x0, int y0, int x1, int y1,
+               uint8_t bits, int first, int last) {
+  line_walk w;
+  if(!line_start(&w, x0, y0, x1, y1, first, last)) return;
+  int32_t sy = w.sy * pitch;
+  int d2 = 2 * w.d;
+  int e2 = 2 * w.e;
+  int32_t err = w.err;
+  int n = w.n;
+  uint8_t *p = fb + w.y * pitch + (w.x >> 3);
+  uint8_t bit = 1 << (w.x & 7);
+  if(w.xMajor) {
+    // x major, one pixel per column.
+    while(n-- > 0) {
+      *p = (*p & ~bit) | (bits & bit);
+      if(err > 0) {
+        p += sy;
+        err -= d2;
+      }
+      err += e2;
+      if(w.sx > 0) {
+        bit <<= 1;
+        if(bit == 0) {
+          bit = 0x01;
+          p++;
+        }
+      } else {
+        bit >>= 1;
+        if(bit == 0) {
+          bit = 0x80;
+          p--;
+        }
+      }
+    }
+  } else {
+    // y major, one pixel per row.
+    while(n-- > 0) {
+      *p = (*p & ~bit) | (bits & bit);
+      if(err > 0) {
+        if(w.sx > 0) {
+          bit <<= 1;
+          if(bit == 0) {
+            bit = 0x01;
+            p++;
+          }
+        } else {
+          bit >>= 1;
+          if(bit == 0) {
+            bit = 0x80;
+            p--;
+          }
+        }
+        err -= d2;
+      }
+      err += e2;
+      p += sy;
+    }
+  }
+}
+
+//=======================================================
+// Run slice line, see M. Abrash, "Graphics Programming
+// Black Book" ch. 36. Row r of the line starts at pixel
+// K(r) = ceil((2 * r * dx - dx + 1) / (2 * dy)), the first
+// pixel Bresenham steps down to it. K(r + 1) is kept as a
+// quotient and remainder and stepped by 2 * dx / (2 * dy)
+// per row, so each run is a fill with no pixel loop.
+// fill is vga_fill_span4() or vga_fill_span1().
+//=======================================================
+static void line_runs(uint8_t *fb, int32_t pitch, int x0, int y0, int x1, int y1,
+                      uint8_t c, int first, int last, void (*fill)(uint8_t *, int, int, uint8_t)) {
+  line_walk w;
+  if(!line_start(&w, x0, y0, x1, y1, first, last)) return;
+  if(!w.xMajor) return; // Callers only pass wide lines.
+  first = (w.x - x0) * w.sx;
+  last = first + w.n - 1;
+  uint8_t *row = fb + w.y * pitch;
+  int32_t sy = w.sy * pitch;
+  int r = w.y - y0;
+  if(r < 0) r = -r;
+  int rLast = (w.e > 0) ? vga_line_minor(last, w.d, w.e) : r;
+  // q = K(r + 1), rem = q * den - num.
+  int32_t den = 2 * w.e;
+  int32_t q = 0, rem = 0, whole = 0, part = 0;
+  if(r < rLast) {
+    int64_t num = 2 * (int64_t)(r + 1) * w.d - w.d + 1;
+    q = (int32_t)((num + den - 1) / den);
+    rem = (int32_t)(q * (int64_t)den - num);
+    whole = (2 * w.d) / den;
+    part = (2 * w.d) % den;
+  }
+  int k = first;
+  for(;;) {
+    int end = (r == rLast) ? last : q - 1;
+    int a = x0 + w.sx * k;
+    int b = x0 + w.sx * end;
+    if(a <= b) fill(row, a, b, c);
+    else fill(row, b, a, c);
+    if(r == rLast) return;
+    k = q;
+    r++;
+    row += sy;
+    q += whole;
+    rem -= part;
+    if(rem < 0) {
+      rem += den;
+      q++;
+    }
+  }
+}
+
+//=======================================================
+// 4 bit run slice line.
+//=======================================================
+void vga_line_runs4(uint8_t *fb, int32_t pitch, int x0, int y0, int x1, int y1,
+                    uint8_t color, int first, int last) {
+  line_runs(fb, pitch, x0, y0, x1, y1, color, first, last, vga_fill_span4);
+}
+
+//=======================================================
+// 1 bit run slice line.
+//=======================================================
+void vga_line_runs1(uint8_t *fb, int32_t pitch, int x0, int y0, int x1, int y1,
+                    uint8_t bits, int first, int last) {
+  line_runs(fb, pitch, x0, y0, x1, y1, bits, first, last, vga_fill_span1);
+}
+
+//=======================================================
+// First pixel whose shorter axis offset is at least m,
+// 1 <= m <= e.
+//=======================================================
+static int line_first(int m, int d, int e) {
+  int64_t num = 2 * (int64_t)m * d - d + 1;
+  return (int)((num + 2 * e - 1) / (2 * e));
+}
+
+//=======================================================
+// Clip a line. The longer axis limits the pixel numbers
+// directly, the shorter axis limits the offsets, which
+// only grow along the line, so they give a range too.
+//=======================================================
+bool vga_line_clip(int x0, int y0, int x1, int y1, int cx0, int cy0, int cx1, int cy1,
+                   int *first, int *last) {
+  int dx = (x1 >= x0) ? x1 - x0 : x0 - x1;
+  int dy = (y1 >= y0) ? y1 - y0 : y0 - y1;
+  bool xMajor = dx >= dy;
+  int d = xMajor ? dx : dy;
+  int e = xMajor ? dy : dx;
+  // Longer axis a, shorter b, and their directions.
+  int a0 = xMajor ? x0 : y0;
+  int b0 = xMajor ? y0 : x0;
+  bool aUp = xMajor ? (x1 >= x0) : (y1 >= y0);
+  bool bUp = xMajor ? (y1 >= y0) : (x1 >= x0);
+  int alo = xMajor ? cx0 : cy0;
+  int ahi = xMajor ? cx1 : cy1;
+  int blo = xMajor ? cy0 : cx0;
+  int bhi = xMajor ? cy1 : cx1;
+  int lo = 0;
+  int hi = d;
+  if(aUp) {
+    if((alo - a0) > lo) lo = alo - a0;
+    if((ahi - a0) < hi) hi = ahi - a0;
+  } else {
+    if((a0 - ahi) > lo) lo = a0 - ahi;
+    if((a0 - alo) < hi) hi = a0 - alo;
+  }
+  int mlo = bUp ? blo - b0 : b0 - bhi;
+  int mhi = bUp ? bhi - b0 : b0 - blo;
+  if((mhi < 0) || (mlo > e)) return false;
+  if(mlo > 0) {
+    int k = line_first(mlo, d, e);
+    if(k > lo) lo = k;
+  }
+  if(mhi < e) {
+    int k = line_first(mhi + 1, d, e) - 1;
+    if(k < hi) hi = k;
+  }
+  if(lo > hi) return false;
+  *first = lo;
+  *last = hi;
+  return true;
+}
@@ -0,0 +1,65 @@
+//============================
+// line.h
+//
+// Line drawing for packed frame buffers. The caller works
+// out which pixels are inside the clip rectangle, then a
+// pointer into the buffer and the pixel's bit position are
+// stepped along the line, so there is no multiply or bounds
+// check per pixel.
+// This file has no Teensy dependencies so it can also
+// be compiled on a host.
+//============================
+#ifndef _LINE_H
+#define _LINE_H
+
+#include <stdint.h>
+
+// Lines at least this many times wider than they are tall
+// are drawn as horizontal runs (vga_line_runs4/1()).
+#define VGA_LINE_RUN_MIN 4
+
+// Lines are numbered along their longer axis, pixel 0 is
+// (x0,y0) and pixel d = max(|x1 - x0|, |y1 - y0|) is (x1,y1).
+// The kernels draw pixels first to last (clamped to 0 to d)
+// exactly where they fall on the whole line, so a line cut
+// with vga_line_clip() has the same pixels as the part of
+// the unclipped line inside the clip rectangle.
+
+// Bresenham line from (x0,y0) to (x1,y1). fb is the first
+// byte of row 0 and pitch the bytes per row. Every pixel
+// drawn must be inside the buffer.
+// 4 bit pixels, even pixel in the low nibble.
+void vga_line4(uint8_t *fb, int32_t pitch, int x0, int y0, int x1, int y1,
+               uint8_t color, int first, int last);
+// 1 bit pixels, pixel x in bit (x & 7). bits is 0x00 or 0xff.
+void vga_line1(uint8_t *fb, int32_t pitch, int x0, int y0, int x1, int y1,
+               uint8_t bits, int first, int last);
+
+// Same as above for lines with |x1 - x0| >= |y1 - y0| (run
+// slice). Each row of the line is one run, its length found
+// from the slope instead of pixel by pixel, and filled with
+// vga_fill_span4/1(). The pixels are the same.
+void vga_line_runs4(uint8_t *fb, int32_t pitch, int x0, int y0, int x1, int y1,
+                    uint8_t color, int first, int last);
+void vga_line_runs1(uint8_t *fb, int32_t pitch, int x0, int y0, int x1, int y1,
+                    uint8_t bits, int first, int last);
+
+// Pixels of the line inside the rectangle (cx0,cy0) to
+// (cx1,cy1), as first and last for the kernels. Returns
+// false if there are none.
+bool vga_line_clip(int x0, int y0, int x1, int y1, int cx0, int cy0, int cx1, int cy1,
+                   int *first, int *last);
+
+// Offset along the shorter axis of pixel k of a line d long
+// and e across (d >= e >= 0, d > 0).
+static inline int vga_line_minor(int k, int d, int e) {
+  return (int)(((int64_t)2 * k * e + d - 1) / (2 * d));
+}
+
+// Bresenham error term at pixel k, m = vga_line_minor(k).
+// The shorter axis steps after pixel k if it is > 0.
+static inline int32_t vga_line_err(int k, int m, int d, int e) {
+  return (int32_t)(2 * (int64_t)e - d + 2 * (int64_t)k * e - 2 * (int64_t)m * d);
+}
+
+#endif // _LINE_H
@@ -0,0 +1,117 @@
+//============================
+// linebuf.cpp
+//
+// Layer composition for line buffer scanout.
+//============================
+#include <stddef.h>
+#include <string.h>
+#include "linebuf.h"
+
+// Font row (MSB = left pixel) to a mask of 8 nibbles
+// (left pixel in the low nibble).
+static uint32_t glyphMask[256];
+// Pixel pair byte to the same two pixels doubled.
+static uint16_t pixelDouble[256];
+
+//=======================================================
+// Build the lookup tables.
+//=======================================================
+void vga_compose_init(void) {
+  for(int b = 0; b < 256; b++) {
+    uint32_t m = 0;
+    for(int i = 0; i < 8; i++) {
+      if(b & (0x80 >> i)) m |= 0xfUL << (i * 4);
+    }
+    glyphMask[b] = m;
+    pixelDouble[b] = ((b & 0x0f) * 0x11) | (((b >> 4) * 0x11) << 8);
+  }
+}
+
+//=======================================================
+// Graphics plane or background color.
+//=======================================================
+static void compose_gfx(const vga_layers_t *l, uint16_t row, uint8_t *line) {
+  uint16_t bytes = l->width / 2;
+  if(l->gfx == NULL) {
+    memset(line, l->background * 0x11, bytes);
+    return;
+  }
+  const uint8_t *src = l->gfx + (uint32_t)(row >> l->gfxShift) * l->gfxPitch;
+  switch(l->gfxShift) {
+    case 0:
+      memcpy(line, src, bytes);
+      break;
+    case 1: {
+      // Each source byte gives 4 pixels.
+      uint16_t *dst = (uint16_t *)line;
+      for(uint16_t i = 0; i < bytes / 2; i++) dst[i] = pixelDouble[src[i]];
+      break;
+    }
+    default: {
+      // Each source byte gives 8 pixels.
+      uint32_t *dst = (uint32_t *)line;
+      for(uint16_t i = 0; i < bytes / 4; i++) {
+        uint8_t s = src[i];
+        dst[i] = ((s & 0x0f) * 0x1111UL) | (((s >> 4) * 0x1111UL) << 16);
+      }
+      break;
+    }
+  }
+}
+
+//=======================================================
+// Text plane, one 32 bit store per cell.
+//=======================================================
+static void compose_text(const vga_layers_t *l, uint16_t row, uint8_t *line) {
+  uint16_t cellRow = row / l->fontHeight;
+  if(cellRow >= l->textRows) return;
+  uint8_t glyphRow = row - cellRow * l->fontHeight;
+  uint16_t cols = l->textCols;
+  if(cols > (l->width / 8)) cols = l->width / 8;
+  const uint8_t *cell = l->text + (uint32_t)cellRow * l->textCols * 2;
+  const uint8_t *font = l->font + glyphRow;
+  uint32_t *dst = (uint32_t *)line;
+  for(uint16_t c = 0; c < cols; c++, cell += 2) {
+    if(cell[0] == 0) continue; // Transparent cell.
+    uint32_t mask = glyphMask[font[cell[0] * l->fontHeight]];
+    uint32_t fg = (cell[1] & 0x0f) * 0x11111111UL;
+    uint32_t bg = (cell[1] >> 4) * 0x11111111UL;
+    dst[c] = (mask & fg) | (~mask & bg);
+  }
+}
+
+//=======================================================
+// Sprites, color 0 is transparent.
+//=======================================================
+static void compose_sprites(const vga_layers_t *l, uint16_t row, uint8_t *line) {
+  for(uint8_t s = 0; s < l->spriteCount; s++) {
+    const vga_sprite_t *sp = &l->sprites[s];
+    int32_t y = (int32_t)row - sp->y;
+    if(!sp->visible || (y < 0) || (y >= sp->h)) continue;
+    const uint8_t *src = sp->image + (uint32_t)y * sp->w;
+    int32_t x0 = sp->x;
+    int32_t i = 0;
+    int32_t n = sp->w;
+    if(x0 < 0) i = -x0;
+    if((x0 + n) > l->width) n = l->width - x0;
+    for(; i < n; i++) {
+      uint8_t c = src[i];
+      if(c == 0) continue;
+      int32_t x = x0 + i;
+      uint8_t *p = &line[x >> 1];
+      if(x & 1) *p = (*p & 0x0f) | (c << 4);
+      else      *p = (*p & 0xf0) | (c & 0x0f);
+    }
+  }
+}
+
+//=======================================================
+// Compose a row, bottom layer first.
+//=======================================================
+void vga_compose_line(const vga_layers_t *layers, uint16_t row, uint8_t *line) {
+  compose_gfx(layers, row, line);
+  if(layers->text && layers->font && layers->fontHeight)
+    compose_text(layers, row, line);
+  if(layers->sprites)
+    compose_sprites(layers, row, line);
+}
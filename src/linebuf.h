@@ -0,0 +1,67 @@
+//============================
+// linebuf.h
+//
+// Layer composition for line buffer scanout.
+// Each display row is built just before it is shown
+// from up to three layers, bottom to top:
+//   graphics plane - 4 bit pixels at full, 1/2 or
+//                    1/4 resolution.
+//   text plane     - character cells (char, attribute).
+//   sprites        - one byte per pixel images.
+// Output rows are 4 bit packed, even pixel in the low
+// nibble, same as the frame buffer.
+// This file has no Teensy dependencies so it can also
+// be compiled on a host.
+//============================
+#ifndef _LINEBUF_H
+#define _LINEBUF_H
+
+#include <stdint.h>
+
+// A sprite. Images are w*h bytes, one color (0-15) per
+// byte, color 0 is transparent. Packed images (packed.h),
+// such as the arrow cursors, are not in this form.
+typedef struct {
+  int16_t  x;        // Top left pixel, may be off screen.
+  int16_t  y;
+  uint16_t w;
+  uint16_t h;
+  const uint8_t *image;
+  bool     visible;
+} vga_sprite_t;
+
+// Layers of a line buffered screen. Planes that are NULL
+// are skipped.
+typedef struct {
+  uint16_t width;       // Pixels per row, multiple of 8.
+  uint16_t height;      // Rows.
+  uint8_t  background;  // Color where there is no graphics plane.
+
+  // Graphics plane, 4 bit packed, (width >> gfxShift) pixels
+  // by (height >> gfxShift) rows.
+  const uint8_t *gfx;
+  uint16_t gfxPitch;    // Bytes per graphics plane row.
+  uint8_t  gfxShift;    // 0 = full, 1 = half, 2 = quarter resolution.
+
+  // Text plane, textCols * textRows pairs of (char, attribute).
+  // Attribute low nibble = foreground, high nibble = background.
+  // Char 0 is a transparent cell.
+  const uint8_t *text;
+  uint16_t textCols;
+  uint16_t textRows;
+  const uint8_t *font;  // 8 pixel wide, fontHeight bytes per char, MSB left.
+  uint8_t  fontHeight;
+
+  // Sprites, drawn in order so the last one is on top.
+  const vga_sprite_t *sprites;
+  uint8_t  spriteCount;
+} vga_layers_t;
+
+// Build the lookup tables. Call once before composing.
+void vga_compose_init(void);
+
+// Compose display row 'row' of layers into line.
+// line must be 4 byte aligned and width/2 bytes long.
+void vga_compose_line(const vga_layers_t *layers, uint16_t row, uint8_t *line);
+
+#endif // _LINEBUF_H
@@ -0,0 +1,114 @@
+//============================
+// nibble.h
+//
+// Word wide kernels for 4 bit packed pixels. Each
+// uint32_t holds 8 pixels, pixel 0 in the low nibble,
+// so a word loaded from the frame buffer at an even
+// pixel lines up with these.
+// On Cortex-M7 the compare kernels use the DSP
+// extension (USUB8 sets a GE flag per byte, SEL picks
+// bytes by those flags), so 4 pixels are tested per
+// instruction. Other targets, and host builds, use a
+// portable scalar version with the same results.
+// Define VGA_NIBBLE_EMULATE_DSP on a host to build the
+// DSP kernels on a C USUB8/SEL, see Extras/tests.
+//============================
+#ifndef _NIBBLE_H
+#define _NIBBLE_H
+
+#include <stdint.h>
+
+#if defined(__ARM_FEATURE_DSP) && !defined(VGA_NIBBLE_SCALAR)
+#define VGA_NIBBLE_DSP 1
+// Per byte, x >= y ? a : b. USUB8 and SEL are kept in
+// one asm so nothing can touch the GE flags between.
+static inline uint32_t vga_sel_ge(uint32_t x, uint32_t y, uint32_t a, uint32_t b) {
+  uint32_t r, t;
+  asm("usub8 %1, %2, %3\n\t"
+      "sel %0, %4, %5"
+      : "=r" (r), "=&r" (t) : "r" (x), "r" (y), "r" (a), "r" (b) : "cc");
+  return r;
+}
+#elif defined(VGA_NIBBLE_EMULATE_DSP) && !defined(VGA_NIBBLE_SCALAR)
+#define VGA_NIBBLE_DSP 1
+// USUB8 then SEL one byte at a time.
+static inline uint32_t vga_sel_ge(uint32_t x, uint32_t y, uint32_t a, uint32_t b) {
+  uint32_t r = 0;
+  for(int i = 0; i < 32; i += 8) {
+    uint32_t m = 0xffUL << i;
+    r |= (((x & m) >= (y & m)) ? a : b) & m;
+  }
+  return r;
+}
+#endif
+
+// Color c (0-15) in all 8 nibbles.
+static inline uint32_t vga_nib_fill(uint8_t c) {
+  return (c & 0x0f) * 0x11111111UL;
+}
+
+// Nibbles of mask set (0xf) take src, the rest keep dst.
+static inline uint32_t vga_nib_merge(uint32_t dst, uint32_t src, uint32_t mask) {
+  return dst ^ ((dst ^ src) & mask);
+}
+
+// 0xf in each nibble of w that is not 0, 0 where it is.
+static inline uint32_t vga_nib_nonzero(uint32_t w) {
+#ifdef VGA_NIBBLE_DSP
+  // Low and high nibbles as two sets of 4 bytes, bytes
+  // >= 1 are not 0.
+  return vga_sel_ge(w & 0x0f0f0f0fUL, 0x01010101UL, 0x0f0f0f0fUL, 0) |
+         vga_sel_ge((w >> 4) & 0x0f0f0f0fUL, 0x01010101UL, 0xf0f0f0f0UL, 0);
+#else
+  w |= w >> 2;
+  w |= w >> 1;
+  return (w & 0x11111111UL) * 0xf;
+#endif
+}
+
+// 0xf in each nibble of w that is not color key.
+static inline uint32_t vga_nib_keymask(uint32_t w, uint8_t key) {
+  return vga_nib_nonzero(w ^ vga_nib_fill(key));
+}
+
+// Colour key blit, nibbles of src that are key are
+// transparent.
+static inline uint32_t vga_nib_key(uint32_t dst, uint32_t src, uint8_t key) {
+  return vga_nib_merge(dst, src, vga_nib_keymask(src, key));
+}
+
+// Substitute color to for color from.
+static inline uint32_t vga_nib_subst(uint32_t w, uint8_t from, uint8_t to) {
+  return vga_nib_merge(vga_nib_fill(to), w, vga_nib_keymask(w, from));
+}
+
+// Exchange colors a and b.
+static inline uint32_t vga_nib_swap(uint32_t w, uint8_t a, uint8_t b) {
+  uint32_t notA = vga_nib_keymask(w, a);
+  uint32_t notB = vga_nib_keymask(w, b);
+  w = vga_nib_merge(vga_nib_fill(b), w, notA);
+  return vga_nib_merge(vga_nib_fill(a), w, notB);
+}
+
+// Realign by one pixel: the 8 pixels starting at pixel
+// 1 of lo, with pixel 0 of hi last.
+static inline uint32_t vga_nib_shift(uint32_t lo, uint32_t hi) {
+  return (lo >> 4) | (hi << 28);
+}
+
+// 0xf in the nibbles of pixels first to last (0-7).
+static inline uint32_t vga_nib_range(int first, int last) {
+  return (0xffffffffUL >> ((7 - last) * 4)) & (0xffffffffUL << (first * 4));
+}
+
+// 0xf in the nibbles of pixels whose bit is set in bits
+// (pixel i in bit i), e.g. from a 1 bit mask.
+static inline uint32_t vga_nib_expand(uint8_t bits) {
+  uint32_t x = bits;
+  x = (x | (x << 12)) & 0x000f000fUL;
+  x = (x | (x << 6)) & 0x03030303UL;
+  x = (x | (x << 3)) & 0x11111111UL;
+  return x * 0xf;
+}
+
+#endif // _NIBBLE_H
@@ -0,0 +1,111 @@
+//============================
+// packed.cpp
+//
+// Packed 4 bit bitmaps.
+//============================
+#include <string.h>
+#include "packed.h"
+#include "nibble.h"
+
+//=======================================================
+// Bytes needed for a bitmap.
+//=======================================================
+uint32_t vga_packed_size(int w, int h, bool mask) {
+  uint32_t bytes = (uint32_t)((w + 1) / 2) * h;
+  if(mask) bytes += (uint32_t)((w + 7) / 8) * h;
+  return bytes;
+}
+
+//=======================================================
+// Pack a one byte per pixel bitmap, pixel rows first
+// then the mask rows.
+//=======================================================
+int vga_packed_from_bytes(vga_packed_t *bm, void *buf, uint32_t size, const uint8_t *src,
+                          int w, int h, bool mask) {
+  if((w <= 0) || (h <= 0)) return -1;
+  uint32_t bytes = vga_packed_size(w, h, mask);
+  if(bytes > size) return -1;
+  memset(buf, 0, bytes);
+  bm->w = w;
+  bm->h = h;
+  bm->pitch = (w + 1) / 2;
+  bm->maskPitch = (w + 7) / 8;
+  uint8_t *pixels = (uint8_t *)buf;
+  uint8_t *bits = mask ? pixels + bm->pitch * h : NULL;
+  for(int y = 0; y < h; y++) {
+    for(int x = 0; x < w; x++) {
+      uint8_t c = *src++ & 0x0f;
+      pixels[y * bm->pitch + (x >> 1)] |= c << ((x & 1) << 2);
+      if(bits && c) bits[y * bm->maskPitch + (x >> 3)] |= 1 << (x & 7);
+    }
+  }
+  bm->pixels = pixels;
+  bm->mask = bits;
+  return 0;
+}
+
+//=======================================================
+// 4 bytes from byte b of a row n bytes long, 0 for bytes
+// outside it.
+//=======================================================
+static inline uint32_t row_word(const uint8_t *row, int b, int n) {
+  uint32_t w = 0;
+  if((b >= 0) && ((b + 4) <= n)) {
+    memcpy(&w, row + b, 4);
+    return w;
+  }
+  for(int i = 0; i < 4; i++)
+    if(((b + i) >= 0) && ((b + i) < n)) w |= (uint32_t)row[b + i] << (i * 8);
+  return w;
+}
+
+//=======================================================
+// Mask bits of pixels s to s + 7, 0 outside the row.
+//=======================================================
+static inline uint8_t mask_byte(const uint8_t *row, int s, int n) {
+  int b = s >> 3;
+  uint32_t v = 0;
+  if((b >= 0) && (b < n)) v = row[b];
+  if(((b + 1) >= 0) && ((b + 1) < n)) v |= (uint32_t)row[b + 1] << 8;
+  return v >> (s & 7);
+}
+
+//=======================================================
+// Draw part of a bitmap row a frame buffer word (8
+// pixels) at a time. s is the bitmap pixel that lands on
+// the word's first pixel. If it is odd the bitmap is a
+// pixel out from the frame buffer, each word is made
+// from two loaded words shifted a nibble, and the second
+// one is kept for the next word.
+//=======================================================
+void vga_packed_row4(uint8_t *dst, int dx, const vga_packed_t *bm, int y, int sx, int w) {
+  if(w <= 0) return;
+  const uint8_t *src = bm->pixels + y * bm->pitch;
+  const uint8_t *mrow = bm->mask ? bm->mask + y * bm->maskPitch : NULL;
+  int n = bm->pitch;
+  int end = dx + w;
+  int p = dx & ~7;
+  int s = sx - (dx - p);
+  bool odd = s & 1;
+  uint32_t lo = odd ? row_word(src, (s - 1) >> 1, n) : 0;
+  for(; p < end; p += 8, s += 8) {
+    uint32_t pix;
+    if(odd) {
+      uint32_t hi = row_word(src, (s + 7) >> 1, n);
+      pix = vga_nib_shift(lo, hi);
+      lo = hi;
+    } else {
+      pix = row_word(src, s >> 1, n);
+    }
+    int first = (p < dx) ? dx - p : 0;
+    int last = ((p + 7) >= end) ? end - 1 - p : 7;
+    uint32_t m = vga_nib_range(first, last);
+    if(mrow) m &= vga_nib_expand(mask_byte(mrow, s, bm->maskPitch));
+    if(m == 0) continue;
+    uint8_t *q = dst + (p >> 1);
+    uint32_t d;
+    memcpy(&d, q, 4);
+    d = vga_nib_merge(d, pix, m);
+    memcpy(q, &d, 4);
+  }
+}
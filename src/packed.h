@@ -0,0 +1,44 @@
+//============================
+// packed.h
+//
+// Packed 4 bit bitmaps, stored the same way as a 4 bit
+// frame buffer row (2 pixels per byte, even pixel in the
+// low nibble), with an optional 1 bit mask plane for
+// transparency. They are drawn 8 pixels at a time with
+// masked word merges instead of pixel by pixel.
+// This file has no Teensy dependencies so it can also
+// be compiled on a host.
+//============================
+#ifndef _PACKED_H
+#define _PACKED_H
+
+#include <stdint.h>
+
+// A packed bitmap.
+typedef struct {
+  int16_t w;              // Size in pixels.
+  int16_t h;
+  uint16_t pitch;         // Bytes per pixel row, (w + 1) / 2.
+  uint16_t maskPitch;     // Bytes per mask row, (w + 7) / 8.
+  const uint8_t *pixels;  // Pixel rows.
+  const uint8_t *mask;    // Mask rows, pixel x in bit (x & 7), set
+                          // where drawn. NULL if there is no mask.
+} vga_packed_t;
+
+// Bytes needed for a w x h bitmap, with or without a mask.
+uint32_t vga_packed_size(int w, int h, bool mask);
+
+// Convert a one byte per pixel bitmap (drawBitmap()
+// format) into buf. With mask, pixels that are 0 are
+// transparent, the same as drawBitmap(). Returns -1 if
+// buf is too small.
+int vga_packed_from_bytes(vga_packed_t *bm, void *buf, uint32_t size, const uint8_t *src,
+                          int w, int h, bool mask);
+
+// Draw w pixels of bitmap row y, from pixel sx of the row
+// to pixel dx of 4 bit frame buffer row dst, skipping those
+// outside the mask. Whole 32 bit words of dst are read and
+// written, the row must have room for them.
+void vga_packed_row4(uint8_t *dst, int dx, const vga_packed_t *bm, int y, int sx, int w);
+
+#endif // _PACKED_H
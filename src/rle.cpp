@@ -0,0 +1,141 @@
+//============================
+// rle.cpp
+//
+// Run length encoded transparent sprites.
+//============================
+#include <stddef.h>
+#include "rle.h"
+#include "span.h"
+#include "blit.h"
+
+// Pixel x of a source row, 0 is transparent.
+#define PIX(row, x) ((row)[x] & 0x0f)
+
+//=======================================================
+// Length of the run of color c from pixel x.
+//=======================================================
+static int run_length(const uint8_t *row, int x, int w, uint8_t c) {
+  int n = 0;
+  while(((x + n) < w) && (PIX(row, x + n) == c)) n++;
+  return n;
+}
+
+//=======================================================
+// Encode. Each row is runs of transparent pixels (left
+// out at the end of the row), single colors and
+// literals, then an end op. Runs over 64 pixels are
+// split. data is written only while it fits in size but
+// the count goes on so the size needed is known.
+//=======================================================
+int32_t vga_rle_encode(vga_rle_t *s, void *buf, uint32_t size, const uint8_t *src, int w, int h) {
+  if((w <= 0) || (h <= 0)) return -1;
+  uint32_t head = h * sizeof(uint16_t);
+  uint16_t *rows = (uint16_t *)buf;
+  uint8_t *data = buf ? (uint8_t *)buf + head : NULL;
+  uint32_t room = (size > head) ? size - head : 0;
+  uint32_t n = 0;
+#define PUT(b) do { if(data && (n < room)) data[n] = (b); n++; } while(0)
+  for(int y = 0; y < h; y++) {
+    const uint8_t *row = src + y * w;
+    if(n > 0xffff) return -1; // Past what a row offset holds.
+    if(buf && (size >= head)) rows[y] = n;
+    int x = 0;
+    while(x < w) {
+      uint8_t c = PIX(row, x);
+      int len = run_length(row, x, w, c);
+      if(c == 0) {
+        if((x + len) == w) break; // Nothing more in this row.
+      } else if(len < VGA_RLE_FILL_MIN) {
+        // Literal, up to the next transparent pixel or color run.
+        len = 0;
+        while(((x + len) < w) && (len < VGA_RLE_MAX) && (PIX(row, x + len) != 0) &&
+              (run_length(row, x + len, w, PIX(row, x + len)) < VGA_RLE_FILL_MIN))
+          len++;
+        PUT(VGA_RLE_LIT | (len - 1));
+        for(int i = 0; i < len; i += 2) {
+          uint8_t b = PIX(row, x + i);
+          if((i + 1) < len) b |= PIX(row, x + i + 1) << 4;
+          PUT(b);
+        }
+        x += len;
+        continue;
+      }
+      x += len;
+      while(len > 0) {
+        int k = (len > VGA_RLE_MAX) ? VGA_RLE_MAX : len;
+        if(c == 0) {
+          PUT(VGA_RLE_SKIP | (k - 1));
+        } else {
+          PUT(VGA_RLE_FILL | (k - 1));
+          PUT(c);
+        }
+        len -= k;
+      }
+    }
+    PUT(VGA_RLE_END);
+  }
+#undef PUT
+  if(buf) {
+    if((head + n) > size) return -1;
+    s->w = w;
+    s->h = h;
+    s->rows = rows;
+    s->data = data;
+  }
+  return head + n;
+}
+
+//=======================================================
+// Draw a 4 bit row. Runs left of x0 are stepped over,
+// the row stops at the first run past x1.
+//=======================================================
+void vga_rle_row4(uint8_t *dst, const uint8_t *runs, int x, int x0, int x1) {
+  const uint8_t *p = runs;
+  while(x <= x1) {
+    uint8_t op = *p++;
+    if(VGA_RLE_OP(op) == VGA_RLE_END) return;
+    int a = x;
+    int b = x + VGA_RLE_COUNT(op) - 1;
+    x = b + 1;
+    if(VGA_RLE_OP(op) == VGA_RLE_SKIP) continue;
+    const uint8_t *lit = p;
+    if(VGA_RLE_OP(op) == VGA_RLE_FILL) p++;
+    else p += (b - a + 2) >> 1;
+    if((b < x0) || (a > x1)) continue;
+    int s = (a < x0) ? x0 : a;
+    int e = (b > x1) ? x1 : b;
+    if(VGA_RLE_OP(op) == VGA_RLE_FILL) vga_fill_span4(dst, s, e, *lit);
+    else vga_copy_row4(dst, s, lit, s - a, e - s + 1);
+  }
+}
+
+//=======================================================
+// Draw a 1 bit row.
+//=======================================================
+void vga_rle_row1(uint8_t *dst, const uint8_t *runs, int x, int x0, int x1, uint8_t bg) {
+  const uint8_t *p = runs;
+  while(x <= x1) {
+    uint8_t op = *p++;
+    if(VGA_RLE_OP(op) == VGA_RLE_END) return;
+    int a = x;
+    int b = x + VGA_RLE_COUNT(op) - 1;
+    x = b + 1;
+    if(VGA_RLE_OP(op) == VGA_RLE_SKIP) continue;
+    const uint8_t *lit = p;
+    if(VGA_RLE_OP(op) == VGA_RLE_FILL) p++;
+    else p += (b - a + 2) >> 1;
+    if((b < x0) || (a > x1)) continue;
+    int s = (a < x0) ? x0 : a;
+    int e = (b > x1) ? x1 : b;
+    if(VGA_RLE_OP(op) == VGA_RLE_FILL) {
+      vga_fill_span1(dst, s, e, (*lit == bg) ? 0x00 : 0xff);
+      continue;
+    }
+    for(int i = s; i <= e; i++) {
+      int k = i - a;
+      uint8_t c = (lit[k >> 1] >> ((k & 1) << 2)) & 0x0f;
+      uint8_t bit = 1 << (i & 7);
+      dst[i >> 3] = (c == bg) ? (dst[i >> 3] & ~bit) : (dst[i >> 3] | bit);
+    }
+  }
+}
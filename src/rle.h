@@ -0,0 +1,56 @@
+//============================
+// rle.h
+//
+// Run length encoded transparent sprites. Each row is a
+// list of runs: transparent pixels are skipped without
+// touching the frame buffer, runs of one color are span
+// filled and the rest copied as packed 4 bit pixels.
+// Good for icons and cursors that are mostly transparent.
+// This file has no Teensy dependencies so it can also
+// be compiled on a host, e.g. to encode sprites at build
+// time.
+//============================
+#ifndef _RLE_H
+#define _RLE_H
+
+#include <stdint.h>
+
+// Run op byte: the op in the top 2 bits, the pixel count
+// - 1 (so 1 to 64) in the low 6 bits.
+#define VGA_RLE_END  0x00  // End of the row.
+#define VGA_RLE_SKIP 0x40  // Transparent pixels.
+#define VGA_RLE_FILL 0x80  // Pixels of one color, in the next byte.
+#define VGA_RLE_LIT  0xc0  // Pixels, in the next (count + 1) / 2 bytes
+                           // packed 2 per byte, first in the low nibble.
+#define VGA_RLE_OP(b)    ((b) & 0xc0)
+#define VGA_RLE_COUNT(b) (((b) & 0x3f) + 1)
+#define VGA_RLE_MAX      64
+
+// Color runs shorter than this are kept in literals.
+#define VGA_RLE_FILL_MIN 3
+
+// An encoded sprite.
+typedef struct {
+  int16_t w;              // Size in pixels.
+  int16_t h;
+  const uint16_t *rows;   // Offset of each row's runs in data.
+  const uint8_t *data;    // Runs.
+} vga_rle_t;
+
+// Encode a one byte per pixel bitmap (drawBitmap() format,
+// 0 is transparent) into buf (2 byte aligned): the row
+// offsets then the runs.
+// Returns the bytes used, or -1 if buf is too small. With
+// buf NULL only the size is worked out.
+int32_t vga_rle_encode(vga_rle_t *s, void *buf, uint32_t size, const uint8_t *src, int w, int h);
+
+// Draw one row's runs with the sprite's first pixel at x.
+// Only pixels x0 to x1 are drawn; runs are clipped whole
+// where they can be, only the ones across x0 or x1 are cut.
+// 4 bit frame buffer row.
+void vga_rle_row4(uint8_t *dst, const uint8_t *runs, int x, int x0, int x1);
+// 1 bit frame buffer row, pixels of color bg are cleared
+// and the rest set.
+void vga_rle_row1(uint8_t *dst, const uint8_t *runs, int x, int x0, int x1, uint8_t bg);
+
+#endif // _RLE_H
@@ -0,0 +1,64 @@
+//============================
+// scanline.cpp
+//
+// Per scanline DMA descriptor table for scanout.
+//============================
+#include <stddef.h>
+#include "scanline.h"
+
+//=======================================================
+// Chain the TCDs. Minor/major loop settings come from
+// proto, SADDR is left alone (see vga_map_lines()).
+//=======================================================
+void vga_chain_lines(vga_tcd_t *tcd, uint16_t lines, const vga_tcd_t *proto) {
+  for(uint16_t i = 0; i < lines; i++) {
+    uint16_t irq = tcd[i].CSR & VGA_TCD_CSR_INTMAJOR;
+    tcd[i].SOFF   = proto->SOFF;
+    tcd[i].ATTR   = proto->ATTR;
+    tcd[i].NBYTES = proto->NBYTES;
+    tcd[i].SLAST  = 0;
+    tcd[i].DADDR  = proto->DADDR;
+    tcd[i].DOFF   = proto->DOFF;
+    tcd[i].CITER  = proto->CITER;
+    tcd[i].BITER  = proto->BITER;
+    if(i < (lines - 1)) {
+      // Load the next line's TCD when this one completes.
+      tcd[i].DLASTSGA = (int32_t)(uintptr_t)&tcd[i+1];
+      tcd[i].CSR = VGA_TCD_CSR_ESG | irq;
+    } else {
+      // Last line, disable the channel until next frame.
+      tcd[i].DLASTSGA = 0;
+      tcd[i].CSR = VGA_TCD_CSR_DREQ | irq;
+    }
+  }
+}
+
+//=======================================================
+// Map display lines to buffer rows.
+//=======================================================
+void vga_map_lines(vga_tcd_t *tcd, uint16_t first, uint16_t count,
+                   uint32_t base, uint32_t pitch, uint16_t row,
+                   uint16_t rows, uint8_t repeat) {
+  uint8_t rep = 0;
+  if(rows == 0) return;
+  if(repeat == 0) repeat = 1;
+  row %= rows;
+  for(uint16_t i = first; i < (first + count); i++) {
+    tcd[i].SADDR = base + (uint32_t)row * pitch;
+    if(++rep >= repeat) {
+      rep = 0;
+      if(++row >= rows) row = 0;
+    }
+  }
+}
+
+//=======================================================
+// Move lines from one buffer to another.
+//=======================================================
+void vga_rebase_lines(vga_tcd_t *tcd, uint16_t lines, uint32_t oldBase,
+                      uint32_t size, uint32_t newBase) {
+  for(uint16_t i = 0; i < lines; i++) {
+    uint32_t offset = tcd[i].SADDR - oldBase;
+    if(offset < size) tcd[i].SADDR = newBase + offset;
+  }
+}
@@ -0,0 +1,59 @@
+//============================
+// scanline.h
+//
+// Per scanline DMA descriptor table for scanout.
+// Every displayed line has its own eDMA TCD and the
+// TCDs are chained with scatter/gather, so each line
+// can fetch its pixels from any row of any buffer.
+// This file only builds the table. It has no Teensy
+// dependencies so it can also be compiled on a host.
+//============================
+#ifndef _SCANLINE_H
+#define _SCANLINE_H
+
+#include <stdint.h>
+
+// eDMA TCD CSR bits used by the table.
+#define VGA_TCD_CSR_INTMAJOR 0x0002
+#define VGA_TCD_CSR_DREQ     0x0008
+#define VGA_TCD_CSR_ESG      0x0010
+
+// Same layout as an eDMA TCD (32 bytes, 32 byte aligned
+// as required for scatter/gather). Addresses are kept
+// as 32 bit values.
+typedef struct __attribute__((aligned(32))) {
+  uint32_t SADDR;
+  int16_t  SOFF;
+  uint16_t ATTR;
+  uint32_t NBYTES;
+  int32_t  SLAST;
+  uint32_t DADDR;
+  int16_t  DOFF;
+  uint16_t CITER;
+  int32_t  DLASTSGA;
+  uint16_t CSR;
+  uint16_t BITER;
+} vga_tcd_t;
+
+// Chain 'lines' TCDs. Each one gets the transfer settings
+// of proto (everything except SADDR) and links to the next.
+// The last TCD stops the channel when it completes.
+// INTMAJOR bits already set in the table are kept.
+void vga_chain_lines(vga_tcd_t *tcd, uint16_t lines, const vga_tcd_t *proto);
+
+// Point display lines first to first+count-1 at rows of a buffer.
+// base   = address of row 0.
+// pitch  = bytes per row.
+// row    = row shown on display line 'first'. Rows wrap at 'rows'.
+// repeat = number of display lines per row (2 for double height).
+void vga_map_lines(vga_tcd_t *tcd, uint16_t first, uint16_t count,
+                   uint32_t base, uint32_t pitch, uint16_t row,
+                   uint16_t rows, uint8_t repeat);
+
+// Move every line that points into oldBase..oldBase+size-1
+// to the same offset from newBase. Lines pointing anywhere
+// else are left alone.
+void vga_rebase_lines(vga_tcd_t *tcd, uint16_t lines, uint32_t oldBase,
+                      uint32_t size, uint32_t newBase);
+
+#endif // _SCANLINE_H
@@ -0,0 +1,64 @@
+//============================
+// span.cpp
+//
+// Horizontal span fill for packed frame buffer rows.
+//============================
+#include <stddef.h>
+#include "span.h"
+
+//=======================================================
+// Fill whole bytes from p up to end. Bytes are stored
+// until p is word aligned, then 16 bytes per pass.
+//=======================================================
+static inline void fill_bytes(uint8_t *p, uint8_t *end, uint8_t c) {
+  while((p < end) && ((uintptr_t)p & 3)) *p++ = c;
+  uint32_t w = c * 0x01010101UL;
+  while((end - p) >= 16) {
+    ((uint32_t *)p)[0] = w;
+    ((uint32_t *)p)[1] = w;
+    ((uint32_t *)p)[2] = w;
+    ((uint32_t *)p)[3] = w;
+    p += 16;
+  }
+  while((end - p) >= 4) {
+    *(uint32_t *)p = w;
+    p += 4;
+  }
+  while(p < end) *p++ = c;
+}
+
+//=======================================================
+// 4 bit span. An odd first pixel is the high nibble of
+// its byte, an even last pixel the low nibble.
+//=======================================================
+void vga_fill_span4(uint8_t *row, int x1, int x2, uint8_t color) {
+  uint8_t c = (color & 0x0f) * 0x11;
+  if(x1 & 1) {
+    row[x1 >> 1] = (row[x1 >> 1] & 0x0f) | (c & 0xf0);
+    x1++;
+  }
+  if(!(x2 & 1)) {
+    row[x2 >> 1] = (row[x2 >> 1] & 0xf0) | (c & 0x0f);
+    x2--;
+  }
+  if(x1 > x2) return;
+  fill_bytes(row + (x1 >> 1), row + (x2 >> 1) + 1, c);
+}
+
+//=======================================================
+// 1 bit span, partial bytes at both ends.
+//=======================================================
+void vga_fill_span1(uint8_t *row, int x1, int x2, uint8_t bits) {
+  int b1 = x1 >> 3;
+  int b2 = x2 >> 3;
+  uint8_t m1 = 0xff << (x1 & 7);
+  uint8_t m2 = 0xff >> (7 - (x2 & 7));
+  if(b1 == b2) {
+    m1 &= m2;
+    row[b1] = (row[b1] & ~m1) | (bits & m1);
+    return;
+  }
+  row[b1] = (row[b1] & ~m1) | (bits & m1);
+  fill_bytes(row + b1 + 1, row + b2, bits);
+  row[b2] = (row[b2] & ~m2) | (bits & m2);
+}
@@ -0,0 +1,24 @@
+//============================
+// span.h
+//
+// Horizontal span fill for packed frame buffer rows.
+// The ragged pixels at each end are merged in, the
+// middle is written with 32 bit stores of the color
+// replicated across a word.
+// This file has no Teensy dependencies so it can also
+// be compiled on a host.
+//============================
+#ifndef _SPAN_H
+#define _SPAN_H
+
+#include <stdint.h>
+
+// Fill pixels x1..x2 (x1 <= x2) of a 4 bit row, even
+// pixel in the low nibble.
+void vga_fill_span4(uint8_t *row, int x1, int x2, uint8_t color);
+
+// Fill pixels x1..x2 (x1 <= x2) of a 1 bit row, pixel
+// x in bit (x & 7). bits is 0x00 or 0xff.
+void vga_fill_span1(uint8_t *row, int x1, int x2, uint8_t bits);
+
+#endif // _SPAN_H
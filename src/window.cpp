@@ -181,3 +181,34 @@ int clearWindow(int winNum) {
   selectWindow(actv);
   return 0;
 }
+
+//============================================================
+// Clip drawing to inside a window. Graphics can then be drawn
+// in window pixel coordinates (see windowOrigin()) without
+// spilling over the frame. Undo with unclipWindow().
+// Return -1 if the window is not open or the clip stack is full.
+//============================================================
+int clipWindow(int winNum) {
+  if(windows[winNum].handle < 0) return -1; // Error: window is not open.
+  int fw = vga4bit.getFontWidth();
+  int fh = vga4bit.getFontHeight();
+  return vga4bit.pushClipRect((windows[winNum].x1 + 1) * fw, (windows[winNum].y1 + 3) * fh,
+                              (windows[winNum].x2 + 1) * fw - 1, (windows[winNum].y2 + 3) * fh - 1);
+}
+
+//============================================================
+// Undo clipWindow().
+//============================================================
+void unclipWindow(void) {
+  vga4bit.popClipRect();
+}
+
+//============================================================
+// Get the top left pixel inside a window.
+//============================================================
+int windowOrigin(int winNum, int *x, int *y) {
+  if(windows[winNum].handle < 0) return -1; // Error: window is not open.
+  *x = (windows[winNum].x1 + 1) * vga4bit.getFontWidth();
+  *y = (windows[winNum].y1 + 3) * vga4bit.getFontHeight();
+  return 0;
+}
@@ -41,5 +41,8 @@ int getActiveWin(void);
 int selectWindow(int winNum);
 int clearWindow(int winNum);
 int windowClose(int winNum);
+int clipWindow(int winNum);
+void unclipWindow(void);
+int windowOrigin(int winNum, int *x, int *y);
 
 #endif // _WINDOW_H